@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "emp/base/notify.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+#include "Hash.hpp"
+#include "Scheduler.hpp"
+
+using emp::String;
+
+// Images and attachments for questions, given with `@ file {description}` lines.  Each file is
+// read once when the bank is loaded and named in the output by the hash of its contents (e.g.
+// assets/3f2a9c0d11e8b7a4.png), so the same figure used by many questions, files, or exam
+// variants is stored once, and a changed figure never reuses an old name.
+
+/// Escape text for use inside an HTML attribute (or a D2L csv field holding HTML).
+static inline String EscapeAttribute(const String & text) {
+  String out;
+  for (char c : text) {
+    switch (c) {
+    case '&':  out += "&amp;";  break;
+    case '<':  out += "&lt;";   break;
+    case '>':  out += "&gt;";   break;
+    case '"':  out += "&quot;"; break;
+    case '\'': out += "&#39;";  break;
+    case ',':  out += "&#44;";  break;
+    default:   out += c;
+    }
+  }
+  return out;
+}
+
+// One asset as used by a question.
+struct AssetRef {
+  String source;        ///< File the asset was loaded from.
+  String given_path;    ///< Path as written on its `@` line (relative to the question file).
+  String path;          ///< Where the asset is placed, relative to the output file.
+  String alt;           ///< Description (alt text for images; link text for attachments).
+
+  bool IsImage() const {
+    const String ext = std::filesystem::path(path.str()).extension().string();
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".gif" || ext == ".svg"
+        || ext == ".webp";
+  }
+
+  /// HTML for the asset: the image itself, or a link to the attachment.
+  String ToHTML() const {
+    if (IsImage()) {
+      return emp::MakeString("<img src='", EscapeAttribute(path), "' alt='", EscapeAttribute(alt),
+                             "'>");
+    }
+    const String text =
+      alt.size() ? alt : String(std::filesystem::path(source.str()).filename().string());
+    return emp::MakeString("<a href='", EscapeAttribute(path), "'>", EscapeAttribute(text), "</a>");
+  }
+
+  /// Latex for the asset (needs the graphicx package for images).
+  String ToLatex() const {
+    if (IsImage()) {
+      return emp::MakeString("\\begin{center}\\includegraphics[width=0.8\\linewidth,"
+        "height=0.3\\textheight,keepaspectratio]{", path, "}\\end{center}\n");
+    }
+    return emp::MakeString("\\noindent Attachment: \\texttt{\\detokenize{", path, "}}\n\n");
+  }
+};
+
+// All of the assets used in a question bank, deduplicated by content.
+class AssetStore {
+private:
+  struct Asset {
+    String source;      ///< First file found with this content.
+    uint64_t size;      ///< Size of the file in bytes.
+  };
+
+  String dir = "assets";                   ///< Directory for assets, relative to the output.
+  std::map<String, Asset> assets;          ///< All assets, by output path.
+  std::map<String, String> source_paths;   ///< Output path for each source file loaded.
+  size_t duplicate_count = 0;              ///< Files found with the same content as another.
+
+public:
+  void SetDir(const String & in) { dir = in; }
+  const String & GetDir() const { return dir; }
+  size_t GetSize() const { return assets.size(); }
+  size_t GetDuplicateCount() const { return duplicate_count; }
+
+  /// Source file for the asset with the provided output path ("" if there is none).
+  String GetSource(const String & path) const {
+    auto it = assets.find(path);
+    return it == assets.end() ? String("") : it->second.source;
+  }
+
+  /// Forget every asset (keeping the directory setting), as when the bank is reloaded.
+  void Clear() {
+    assets.clear();
+    source_paths.clear();
+    duplicate_count = 0;
+  }
+
+  emp::vector<String> GetPaths() const {
+    emp::vector<String> paths;
+    for (const auto & [path, asset] : assets) paths.push_back(path);
+    return paths;
+  }
+
+  /// Add an asset from a file (given by its canonical path), returning the path to use for it
+  /// in output (or an empty string, after reporting the problem, if it cannot be read).
+  String Add(const String & source) {
+    if (auto it = source_paths.find(source); it != source_paths.end()) return it->second;
+
+    std::ifstream file(source.str(), std::ios::binary);
+    if (!file) {
+      emp::notify::Error("Unable to open asset file '", source, "'.");
+      return "";
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    const std::string content = ss.str();
+
+    const String ext = std::filesystem::path(source.str()).extension().string();
+    const String hash = Hasher().Add(std::string_view(content)).GetHex();
+    const String path = emp::MakeString(dir, '/', hash, ext);
+    auto [it, is_new] = assets.try_emplace(path, Asset{source, content.size()});
+    if (!is_new) ++duplicate_count;
+    source_paths[source] = path;
+    return path;
+  }
+
+  /// Place the assets with the provided output paths next to an output file in out_dir (the
+  /// directory of the output file; empty for the current directory), in parallel.  Assets are
+  /// copied, or hardlinked to their sources when `hardlink` is set (falling back to a copy
+  /// across filesystems).  Any asset already in place is skipped, since its name is its
+  /// content hash.  Returns the number of files placed.
+  size_t Export(const emp::vector<String> & paths, const String & out_dir, Scheduler & scheduler,
+                bool hardlink=false) const {
+    if (paths.empty()) return 0;
+    const std::set<String> path_set(paths.begin(), paths.end());
+    const emp::vector<String> unique_paths(path_set.begin(), path_set.end());
+    std::error_code ec;
+    std::filesystem::create_directories(String(out_dir + dir).str(), ec);
+
+    std::atomic<size_t> placed_count = 0;
+    scheduler.ParallelFor(0, unique_paths.size(), [&](size_t i){
+      auto it = assets.find(unique_paths[i]);
+      if (it == assets.end()) return;
+      const Asset & asset = it->second;
+      const std::filesystem::path target = String(out_dir + it->first).str();
+      std::error_code ec;
+      if (std::filesystem::file_size(target, ec) == asset.size && !ec) return;  // Already there.
+      if (hardlink) {
+        std::filesystem::remove(target, ec);
+        std::filesystem::create_hard_link(asset.source.str(), target, ec);
+        if (!ec || std::filesystem::exists(target)) { ++placed_count; return; }
+      }
+      // Copy to a temporary file and rename it into place, so other jobs never see a partial
+      // asset; the temporary name is unique to this thread.
+      std::filesystem::path tmp = target;
+      tmp += emp::MakeString(".tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+      std::filesystem::copy_file(asset.source.str(), tmp,
+                                 std::filesystem::copy_options::overwrite_existing, ec);
+      if (!ec) std::filesystem::rename(tmp, target, ec);
+      if (ec) {
+        emp::notify::Error("Unable to place asset '", asset.source, "' at '", target.string(),
+                           "': ", ec.message());
+        std::filesystem::remove(tmp, ec);
+        return;
+      }
+      ++placed_count;
+    });
+    return placed_count;
+  }
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <zlib.h>
+
+// zstd support is optional; build with `make ZSTD=1` (requires libzstd).
+#if defined(QBL_ZSTD) && __has_include(<zstd.h>)
+#include <zstd.h>
+#define QBL_HAS_ZSTD 1
+#else
+#define QBL_HAS_ZSTD 0
+#endif
+
+#include "emp/tools/String.hpp"
+
+#include "SpscQueue.hpp"
+
+using emp::String;
+
+// Reads a gzip (or zstd) compressed question file as lines of text.  Decompression happens on
+// its own thread, which passes blocks of text to the parser through a bounded queue; the
+// compressed file is never expanded on disk, or all at once in memory.
+class DecompressStream {
+public:
+  enum class Codec { NONE = 0, GZIP, ZSTD };
+
+private:
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;   ///< Bytes to read or produce at a time.
+
+  Codec codec;
+  String filename;           ///< File to read from (if no contents were provided)
+  std::string input;         ///< Compressed contents (if already read)
+  SpscQueue<std::string, 64> blocks;  ///< Decompressed text, ready for the parser.
+  String error = "";         ///< Description of any problem decompressing (set before Close).
+  std::thread thread;
+
+  std::string pending;       ///< Text from the current block not yet returned as lines.
+  size_t pending_pos = 0;
+
+  // Provide the next chunk of compressed input; returns false at the end of the input.
+  template <typename FUN_T>
+  bool _ForEachInput(FUN_T && fun) {
+    if (filename.empty()) return fun(std::string_view(input));
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) { error = "unable to open file"; return false; }
+    std::string buffer(BLOCK_SIZE, '\0');
+    bool ok = true;
+    while (ok) {
+      const ssize_t count = read(fd, buffer.data(), buffer.size());
+      if (count < 0) { error = "read failed"; ok = false; break; }
+      if (count == 0) break;
+      ok = fun(std::string_view(buffer.data(), static_cast<size_t>(count)));
+    }
+    close(fd);
+    return ok;
+  }
+
+  void _DecodeGzip() {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) { error = "unable to start gzip decoder"; return; }
+    bool at_end = false;
+    _ForEachInput([&](std::string_view in){
+      stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in.data()));
+      stream.avail_in = static_cast<uInt>(in.size());
+      while (stream.avail_in) {
+        if (at_end) {                // Another gzip member follows the last one.
+          inflateReset(&stream);
+          at_end = false;
+        }
+        std::string out(BLOCK_SIZE, '\0');
+        stream.next_out = reinterpret_cast<Bytef *>(out.data());
+        stream.avail_out = static_cast<uInt>(out.size());
+        const int result = inflate(&stream, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+          error = String("corrupt gzip data") + (stream.msg ? String(": ") + stream.msg : String(""));
+          return false;
+        }
+        out.resize(out.size() - stream.avail_out);
+        if (out.size()) blocks.Push(std::move(out));
+        if (result == Z_STREAM_END) at_end = true;
+        else if (result == Z_BUF_ERROR) break;   // Needs more input.
+      }
+      return true;
+    });
+    if (error.empty() && !at_end) error = "gzip data is truncated";
+    inflateEnd(&stream);
+  }
+
+#if QBL_HAS_ZSTD
+  void _DecodeZstd() {
+    ZSTD_DStream * stream = ZSTD_createDStream();
+    size_t last_result = 0;
+    _ForEachInput([&](std::string_view in){
+      ZSTD_inBuffer in_buf{ in.data(), in.size(), 0 };
+      while (in_buf.pos < in_buf.size) {
+        std::string out(BLOCK_SIZE, '\0');
+        ZSTD_outBuffer out_buf{ out.data(), out.size(), 0 };
+        last_result = ZSTD_decompressStream(stream, &out_buf, &in_buf);
+        if (ZSTD_isError(last_result)) {
+          error = String("corrupt zstd data: ") + ZSTD_getErrorName(last_result);
+          return false;
+        }
+        out.resize(out_buf.pos);
+        if (out.size()) blocks.Push(std::move(out));
+      }
+      return true;
+    });
+    if (error.empty() && last_result != 0) error = "zstd data is truncated";
+    ZSTD_freeDStream(stream);
+  }
+#endif
+
+  void _Decode() {
+    switch (codec) {
+    case Codec::GZIP: _DecodeGzip(); break;
+    case Codec::ZSTD:
+#if QBL_HAS_ZSTD
+      _DecodeZstd();
+#else
+      error = "zstd input requires QBL to be built with ZSTD=1";
+#endif
+      break;
+    case Codec::NONE: break;
+    }
+    blocks.Close();
+  }
+
+public:
+  /// Decompress a file from disk.
+  DecompressStream(Codec codec, const String & filename) : codec(codec), filename(filename) {
+    thread = std::thread([this](){ _Decode(); });
+  }
+
+  /// Decompress contents that have already been read.
+  DecompressStream(Codec codec, std::string && contents) : codec(codec), input(std::move(contents)) {
+    thread = std::thread([this](){ _Decode(); });
+  }
+
+  DecompressStream(const DecompressStream &) = delete;
+  ~DecompressStream() {
+    std::string discard;
+    while (blocks.Pop(discard)) { }   // Let the decoder finish if we stopped reading early.
+    thread.join();
+  }
+
+  /// Identify the compression format (if any) from the first bytes of a file.
+  static Codec DetectCodec(std::string_view start) {
+    if (start.size() >= 2 && start.substr(0, 2) == "\x1f\x8b") return Codec::GZIP;
+    if (start.size() >= 4 && start.substr(0, 4) == "\x28\xb5\x2f\xfd") return Codec::ZSTD;
+    return Codec::NONE;
+  }
+
+  static Codec DetectFileCodec(const String & filename) {
+    char start[4];
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return Codec::NONE;
+    const ssize_t count = read(fd, start, sizeof(start));
+    close(fd);
+    return (count > 0) ? DetectCodec(std::string_view(start, static_cast<size_t>(count))) : Codec::NONE;
+  }
+
+  /// Get the next line of text (without its newline); returns false at the end of the file.
+  bool GetLine(String & line) {
+    std::string text;
+    while (true) {
+      const size_t end = pending.find('\n', pending_pos);
+      if (end != std::string::npos) {
+        text.append(pending, pending_pos, end - pending_pos);
+        pending_pos = end + 1;
+        line = text;
+        return true;
+      }
+      text.append(pending, pending_pos);    // Line continues into the next block.
+      pending_pos = 0;
+      if (!blocks.Pop(pending)) {
+        pending.clear();
+        if (text.empty()) return false;
+        line = text;                        // Last line had no newline.
+        return true;
+      }
+    }
+  }
+
+  /// Any problem found while decompressing (only complete once GetLine has returned false).
+  const String & GetError() const { return error; }
+};
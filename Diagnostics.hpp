@@ -0,0 +1,67 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "emp/base/notify.hpp"
+#include "emp/base/vector.hpp"
+
+// Warnings and errors about individual questions.  When questions are processed in parallel,
+// each one's diagnostics are collected in its own log while it runs (see Capture) and reported
+// afterward in question order, so what is printed never depends on thread scheduling.  With
+// no log collecting on the current thread, diagnostics are reported immediately.
+class DiagnosticLog {
+private:
+  struct Message {
+    bool is_error;
+    std::string text;
+  };
+
+  emp::vector<Message> messages;
+  static inline thread_local DiagnosticLog * active = nullptr;  ///< Log collecting (if any)
+
+  static void _Report(bool is_error, std::string && text) {
+    if (active) active->messages.push_back(Message{is_error, std::move(text)});
+    else if (is_error) emp::notify::Error(text);
+    else emp::notify::Warning(text);
+  }
+
+  template <typename... Ts>
+  static std::string _Join(Ts &&... args) {
+    std::stringstream ss;
+    (ss << ... << std::forward<Ts>(args));
+    return ss.str();
+  }
+
+public:
+  template <typename... Ts>
+  static void Warning(Ts &&... args) { _Report(false, _Join(std::forward<Ts>(args)...)); }
+
+  template <typename... Ts>
+  static void Error(Ts &&... args) { _Report(true, _Join(std::forward<Ts>(args)...)); }
+
+  template <typename... Ts>
+  static bool TestError(bool test, Ts &&... args) {
+    if (test) Error(std::forward<Ts>(args)...);
+    return test;
+  }
+
+  bool IsEmpty() const { return messages.empty(); }
+
+  /// Run fun(), collecting anything it reports on this thread into this log.
+  template <typename FUN_T>
+  void Capture(FUN_T && fun) {
+    DiagnosticLog * prev = active;
+    active = this;
+    try { fun(); }
+    catch (...) { active = prev; throw; }
+    active = prev;
+  }
+
+  /// Pass on everything collected (to the log collecting on this thread, if any), in order.
+  void Report() {
+    for (Message & message : messages) _Report(message.is_error, std::move(message.text));
+    messages.clear();
+  }
+};
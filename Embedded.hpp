@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+// Layout of a question bank compiled into the executable.  `QBL --emit-cpp file.hpp` writes a
+// header defining `qbl_embedded_bank` from the loaded questions; building with
+// -DQBL_EMBEDDED_BANK='"file.hpp"' (see `make embedded`) includes it, so the bank can be set
+// up at startup without reading or parsing any files.
+
+struct EmbeddedTag {
+  std::string_view name;       ///< Full tag, including its '#', '^', or ':' prefix.
+  std::string_view value;      ///< Value assigned (config tags only).
+};
+
+struct EmbeddedTagBlock {
+  size_t tag_start;            ///< Position of the first tag in the block.
+  size_t tag_count;            ///< Number of tags in the block.
+};
+
+struct EmbeddedOption {
+  std::string_view text;
+  bool is_correct;
+  bool is_fixed;
+  bool is_required;
+};
+
+struct EmbeddedQuestion {
+  std::string_view type;       ///< Question type, as used in control commands.
+  size_t id;
+  std::string_view source;     ///< Name of the file the question was loaded from.
+  std::string_view question;
+  std::string_view alt_question;
+  std::string_view explanation;
+  std::string_view hint;
+  bool is_required;
+  bool is_fixed;
+  size_t own_block;            ///< Tag block holding the question's own tags.
+  size_t shared_start;         ///< Position of the first shared block ID (in shared_blocks).
+  size_t shared_count;         ///< Number of shared tag blocks.
+  size_t option_start;         ///< Position of the first option.
+  size_t option_count;         ///< Number of options.
+};
+
+struct EmbeddedBank {
+  std::span<const EmbeddedQuestion> questions;
+  std::span<const EmbeddedOption> options;
+  std::span<const EmbeddedTag> tags;
+  std::span<const EmbeddedTagBlock> blocks;
+  std::span<const size_t> shared_blocks;   ///< Shared tag blocks used by each question.
+  std::span<const std::string_view> source_files;
+};
+
+/// Write text as a C++ string literal.
+static inline std::string ToCppLiteral(std::string_view text) {
+  std::string out = "\"";
+  for (char c : text) {
+    switch (c) {
+    case '\\': out += "\\\\"; break;
+    case '"':  out += "\\\""; break;
+    case '\n': out += "\\n";  break;
+    case '\t': out += "\\t";  break;
+    case '\r': out += "\\r";  break;
+    case '?':  out += "\\?";  break;    // Avoid accidental trigraphs in older compilers.
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        const char digits[] = "01234567";
+        const unsigned char uc = static_cast<unsigned char>(c);
+        out += '\\';
+        out += digits[(uc >> 6) & 7];
+        out += digits[(uc >> 3) & 7];
+        out += digits[uc & 7];
+      }
+      else out += c;
+    }
+  }
+  out += '"';
+  return out;
+}
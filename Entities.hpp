@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "Symbols.hpp"
+
+// Named character entities (as used in `\\&name;` escapes): the full HTML 4 set, plus `apos`.
+// Names are found through a perfect hash built at compile time using "hash and displace": each
+// name is first hashed into a bucket, and each bucket is assigned a seed that sends all of its
+// names to distinct, otherwise-unused slots.  A lookup is then two hashes and one comparison.
+
+struct EntityName {
+  std::string_view name;    ///< Entity name, without the '&' and ';'
+  uint32_t codepoint;       ///< Unicode code point that the entity produces.
+};
+
+static constexpr EntityName entity_names[] = {
+  {"quot",0x22}, {"amp",0x26}, {"apos",0x27}, {"lt",0x3C}, {"gt",0x3E}, {"nbsp",0xA0}, {"iexcl",0xA1},
+  {"cent",0xA2}, {"pound",0xA3}, {"curren",0xA4}, {"yen",0xA5}, {"brvbar",0xA6}, {"sect",0xA7},
+  {"uml",0xA8}, {"copy",0xA9}, {"ordf",0xAA}, {"laquo",0xAB}, {"not",0xAC}, {"shy",0xAD},
+  {"reg",0xAE}, {"macr",0xAF}, {"deg",0xB0}, {"plusmn",0xB1}, {"sup2",0xB2}, {"sup3",0xB3},
+  {"acute",0xB4}, {"micro",0xB5}, {"para",0xB6}, {"middot",0xB7}, {"cedil",0xB8},
+  {"sup1",0xB9}, {"ordm",0xBA}, {"raquo",0xBB}, {"frac14",0xBC}, {"frac12",0xBD},
+  {"frac34",0xBE}, {"iquest",0xBF}, {"Agrave",0xC0}, {"Aacute",0xC1}, {"Acirc",0xC2},
+  {"Atilde",0xC3}, {"Auml",0xC4}, {"Aring",0xC5}, {"AElig",0xC6}, {"Ccedil",0xC7},
+  {"Egrave",0xC8}, {"Eacute",0xC9}, {"Ecirc",0xCA}, {"Euml",0xCB}, {"Igrave",0xCC},
+  {"Iacute",0xCD}, {"Icirc",0xCE}, {"Iuml",0xCF}, {"ETH",0xD0}, {"Ntilde",0xD1},
+  {"Ograve",0xD2}, {"Oacute",0xD3}, {"Ocirc",0xD4}, {"Otilde",0xD5}, {"Ouml",0xD6},
+  {"times",0xD7}, {"Oslash",0xD8}, {"Ugrave",0xD9}, {"Uacute",0xDA}, {"Ucirc",0xDB},
+  {"Uuml",0xDC}, {"Yacute",0xDD}, {"THORN",0xDE}, {"szlig",0xDF}, {"agrave",0xE0},
+  {"aacute",0xE1}, {"acirc",0xE2}, {"atilde",0xE3}, {"auml",0xE4}, {"aring",0xE5},
+  {"aelig",0xE6}, {"ccedil",0xE7}, {"egrave",0xE8}, {"eacute",0xE9}, {"ecirc",0xEA},
+  {"euml",0xEB}, {"igrave",0xEC}, {"iacute",0xED}, {"icirc",0xEE}, {"iuml",0xEF}, {"eth",0xF0},
+  {"ntilde",0xF1}, {"ograve",0xF2}, {"oacute",0xF3}, {"ocirc",0xF4}, {"otilde",0xF5},
+  {"ouml",0xF6}, {"divide",0xF7}, {"oslash",0xF8}, {"ugrave",0xF9}, {"uacute",0xFA},
+  {"ucirc",0xFB}, {"uuml",0xFC}, {"yacute",0xFD}, {"thorn",0xFE}, {"yuml",0xFF},
+  {"OElig",0x152}, {"oelig",0x153}, {"Scaron",0x160}, {"scaron",0x161}, {"Yuml",0x178},
+  {"fnof",0x192}, {"circ",0x2C6}, {"tilde",0x2DC}, {"Alpha",0x391}, {"Beta",0x392},
+  {"Gamma",0x393}, {"Delta",0x394}, {"Epsilon",0x395}, {"Zeta",0x396}, {"Eta",0x397},
+  {"Theta",0x398}, {"Iota",0x399}, {"Kappa",0x39A}, {"Lambda",0x39B}, {"Mu",0x39C},
+  {"Nu",0x39D}, {"Xi",0x39E}, {"Omicron",0x39F}, {"Pi",0x3A0}, {"Rho",0x3A1}, {"Sigma",0x3A3},
+  {"Tau",0x3A4}, {"Upsilon",0x3A5}, {"Phi",0x3A6}, {"Chi",0x3A7}, {"Psi",0x3A8},
+  {"Omega",0x3A9}, {"alpha",0x3B1}, {"beta",0x3B2}, {"gamma",0x3B3}, {"delta",0x3B4},
+  {"epsilon",0x3B5}, {"zeta",0x3B6}, {"eta",0x3B7}, {"theta",0x3B8}, {"iota",0x3B9},
+  {"kappa",0x3BA}, {"lambda",0x3BB}, {"mu",0x3BC}, {"nu",0x3BD}, {"xi",0x3BE},
+  {"omicron",0x3BF}, {"pi",0x3C0}, {"rho",0x3C1}, {"sigmaf",0x3C2}, {"sigma",0x3C3},
+  {"tau",0x3C4}, {"upsilon",0x3C5}, {"phi",0x3C6}, {"chi",0x3C7}, {"psi",0x3C8},
+  {"omega",0x3C9}, {"thetasym",0x3D1}, {"upsih",0x3D2}, {"piv",0x3D6}, {"ensp",0x2002},
+  {"emsp",0x2003}, {"thinsp",0x2009}, {"zwnj",0x200C}, {"zwj",0x200D}, {"lrm",0x200E},
+  {"rlm",0x200F}, {"ndash",0x2013}, {"mdash",0x2014}, {"lsquo",0x2018}, {"rsquo",0x2019},
+  {"sbquo",0x201A}, {"ldquo",0x201C}, {"rdquo",0x201D}, {"bdquo",0x201E}, {"dagger",0x2020},
+  {"Dagger",0x2021}, {"bull",0x2022}, {"hellip",0x2026}, {"permil",0x2030}, {"prime",0x2032},
+  {"Prime",0x2033}, {"lsaquo",0x2039}, {"rsaquo",0x203A}, {"oline",0x203E}, {"frasl",0x2044},
+  {"euro",0x20AC}, {"image",0x2111}, {"weierp",0x2118}, {"real",0x211C}, {"trade",0x2122},
+  {"alefsym",0x2135}, {"larr",0x2190}, {"uarr",0x2191}, {"rarr",0x2192}, {"darr",0x2193},
+  {"harr",0x2194}, {"crarr",0x21B5}, {"lArr",0x21D0}, {"uArr",0x21D1}, {"rArr",0x21D2},
+  {"dArr",0x21D3}, {"hArr",0x21D4}, {"forall",0x2200}, {"part",0x2202}, {"exist",0x2203},
+  {"empty",0x2205}, {"nabla",0x2207}, {"isin",0x2208}, {"notin",0x2209}, {"ni",0x220B},
+  {"prod",0x220F}, {"sum",0x2211}, {"minus",0x2212}, {"lowast",0x2217}, {"radic",0x221A},
+  {"prop",0x221D}, {"infin",0x221E}, {"ang",0x2220}, {"and",0x2227}, {"or",0x2228},
+  {"cap",0x2229}, {"cup",0x222A}, {"int",0x222B}, {"there4",0x2234}, {"sim",0x223C},
+  {"cong",0x2245}, {"asymp",0x2248}, {"ne",0x2260}, {"equiv",0x2261}, {"le",0x2264},
+  {"ge",0x2265}, {"sub",0x2282}, {"sup",0x2283}, {"nsub",0x2284}, {"sube",0x2286},
+  {"supe",0x2287}, {"oplus",0x2295}, {"otimes",0x2297}, {"perp",0x22A5}, {"sdot",0x22C5},
+  {"lceil",0x2308}, {"rceil",0x2309}, {"lfloor",0x230A}, {"rfloor",0x230B}, {"lang",0x2329},
+  {"rang",0x232A}, {"loz",0x25CA}, {"spades",0x2660}, {"clubs",0x2663}, {"hearts",0x2665},
+  {"diams",0x2666},
+};
+
+namespace entities {
+  static constexpr size_t NUM_ENTITIES = std::size(entity_names);
+  static constexpr size_t NUM_BUCKETS = 128;
+  static constexpr size_t NUM_SLOTS = 512;     // Must be a power of two.
+  static constexpr uint16_t EMPTY = static_cast<uint16_t>(-1);
+
+  static constexpr uint32_t Hash(std::string_view name, uint32_t seed) {
+    uint32_t value = 2166136261u ^ (seed * 16777619u);   // FNV-1a, offset by the seed.
+    for (char c : name) {
+      value ^= static_cast<uint8_t>(c);
+      value *= 16777619u;
+    }
+    return value ^ (value >> 15);
+  }
+
+  struct PerfectHash {
+    std::array<uint16_t, NUM_BUCKETS> seeds{};   ///< Seed to use for the names in each bucket.
+    std::array<uint16_t, NUM_SLOTS> slots{};     ///< Index into entity_names (or EMPTY).
+  };
+
+  static constexpr PerfectHash MakePerfectHash() {
+    PerfectHash table;
+    for (auto & slot : table.slots) slot = EMPTY;
+
+    // Group names by bucket.
+    std::array<std::array<uint16_t, NUM_ENTITIES>, NUM_BUCKETS> members{};
+    std::array<size_t, NUM_BUCKETS> sizes{};
+    for (size_t i = 0; i < NUM_ENTITIES; ++i) {
+      const size_t bucket = Hash(entity_names[i].name, 0) % NUM_BUCKETS;
+      members[bucket][sizes[bucket]++] = static_cast<uint16_t>(i);
+    }
+
+    // Place the largest buckets first, while there is the most room.
+    std::array<size_t, NUM_BUCKETS> order{};
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) order[i] = i;
+    for (size_t i = 1; i < NUM_BUCKETS; ++i) {     // Insertion sort (stable, constexpr).
+      for (size_t j = i; j > 0 && sizes[order[j-1]] < sizes[order[j]]; --j) {
+        std::swap(order[j-1], order[j]);
+      }
+    }
+
+    for (size_t bucket : order) {
+      if (sizes[bucket] == 0) break;
+      for (uint16_t seed = 1; seed != 0; ++seed) {
+        std::array<size_t, NUM_ENTITIES> targets{};
+        bool fits = true;
+        for (size_t i = 0; i < sizes[bucket] && fits; ++i) {
+          targets[i] = Hash(entity_names[members[bucket][i]].name, seed) & (NUM_SLOTS - 1);
+          if (table.slots[targets[i]] != EMPTY) fits = false;
+          for (size_t j = 0; j < i && fits; ++j) fits = (targets[j] != targets[i]);
+        }
+        if (!fits) continue;
+        table.seeds[bucket] = seed;
+        for (size_t i = 0; i < sizes[bucket]; ++i) table.slots[targets[i]] = members[bucket][i];
+        break;
+      }
+    }
+    return table;
+  }
+
+  static constexpr PerfectHash perfect_hash = MakePerfectHash();
+}
+
+/// Find the code point for a named entity; returns 0 if the name is unknown.
+static constexpr uint32_t FindEntity(std::string_view name) {
+  using namespace entities;
+  const uint16_t seed = perfect_hash.seeds[Hash(name, 0) % NUM_BUCKETS];
+  if (seed == 0) return 0;    // Empty bucket.
+  const uint16_t id = perfect_hash.slots[Hash(name, seed) & (NUM_SLOTS - 1)];
+  if (id == EMPTY || entity_names[id].name != name) return 0;
+  return entity_names[id].codepoint;
+}
+
+/// Find the code point for the contents of a `\\&...;` escape: either a name (`Omega`) or a
+/// decimal (`#937`) or hex (`#x3A9`) character reference.  Returns 0 if it is not recognized.
+static constexpr uint32_t ParseEntity(std::string_view entity) {
+  if (entity.size() < 2 || entity[0] != '#') return FindEntity(entity);
+  const bool is_hex = (entity[1] == 'x' || entity[1] == 'X');
+  entity.remove_prefix(is_hex ? 2 : 1);
+  if (entity.empty() || entity.size() > 8) return 0;
+  uint32_t codepoint = 0;
+  for (char c : entity) {
+    uint32_t digit = 16;
+    if (c >= '0' && c <= '9') digit = static_cast<uint32_t>(c - '0');
+    else if (is_hex && c >= 'a' && c <= 'f') digit = static_cast<uint32_t>(c - 'a' + 10);
+    else if (is_hex && c >= 'A' && c <= 'F') digit = static_cast<uint32_t>(c - 'A' + 10);
+    if (digit >= (is_hex ? 16u : 10u)) return 0;
+    codepoint = codepoint * (is_hex ? 16 : 10) + digit;
+  }
+  return (codepoint <= 0x10FFFF) ? codepoint : 0;
+}
+
+namespace entities {
+  static constexpr bool AllFound() {
+    for (const EntityName & entity : entity_names) {
+      if (FindEntity(entity.name) != entity.codepoint) return false;
+      if (FindSymbol(entity.codepoint) == nullptr) return false;
+    }
+    return true;
+  }
+  static_assert(AllFound(), "Every entity must be in the perfect hash and the symbol table.");
+  static_assert(FindEntity("Omega") == 0x3A9 && FindEntity("omega") == 0x3C9);
+  static_assert(FindEntity("bogus") == 0 && FindEntity("") == 0);
+  static_assert(ParseEntity("#937") == 0x3A9 && ParseEntity("#x3a9") == 0x3A9);
+}
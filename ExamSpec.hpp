@@ -0,0 +1,269 @@
+#pragma once
+
+#include <cctype>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "emp/base/notify.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/config/FlagManager.hpp"
+#include "emp/datastructs/vector_utils.hpp"
+#include "emp/tools/String.hpp"
+
+using emp::String;
+
+// All of the settings needed to produce a single exam from a loaded question bank.
+class ExamSpec {
+public:
+  enum class Format {
+    NONE=0,
+    QBL,
+    D2L,
+    GRADESCOPE,
+    LATEX,
+    WEB,
+    DEBUG
+  };
+
+  enum class Order {
+    DEFAULT = 0,
+    RANDOM,
+    ID,
+    ALPHABETIC
+  };
+
+  Format format = Format::NONE;       // No format set yet.
+  Order order = Order::DEFAULT;       // Don't reorder questions.
+  String base_path = "";              // Where are we placing these files?
+  String base_filename = "";          // Output filename; empty=no file
+  String extension = "";              // Provided extension to use for output file.
+  String log_filename = "";           // Where should we log questions to?
+  String manifest_filename = "";      // Where to record how to regenerate this exam
+  String title = "Multiple Choice Quiz"; // Title to use in any generated files.
+  emp::vector<String> include_tags;   // Include ALL questions with these tags.
+  emp::vector<String> exclude_tags;   // Exclude ALL questions with these tags (override includes)
+  emp::vector<String> require_tags;   // ONLY questions with these tags can be included.
+  emp::vector<String> sample_tags;    // Include at least one question with each of these tags.
+  emp::vector<String> avoid_files;    // Files with lists of questions IDs to avoid
+  size_t generate_count = 0;          // How many questions should be generated? (0 = use all)
+  int random_seed = -1;               // Random number seed (-1 = seed from time)
+  bool compressed_format = false;     // Should GradeScope output be compressed?
+  bool split_fragments = false;       // Should each Latex question get its own file?
+  size_t part_kb = 0;                 // Largest D2L part file in kilobytes (0 = no limit)
+  size_t part_rows = 0;               // Most rows in a D2L part file (0 = no limit)
+
+private:
+  // Helper functions
+  void _AddTags(emp::vector<String> & tags, const String & arg, size_t count=1) {
+    auto args = arg.Slice();
+    for (size_t i = 0; i < count; ++i) {
+      emp::Append(tags, args);
+    }
+  }
+
+public:
+  /// Register all of the flags that configure an exam with the provided flag manager.
+  void AddFlags(emp::FlagManager & flags) {
+    flags.AddGroup("Basic Operation",
+      "These flags are the standard ones to use when running QBL.\n");
+    flags.AddOption('g', "--generate",[this](String arg){ SetGenerate(arg); },
+      "Randomly generate questions (number as arg).");
+//    flags.AddOption('I', "--interactive",     [this](){},
+//      "Start QBL in interactive mode for more dynamic exam generation.");
+    flags.AddOption('o', "--output",  [this](String arg){ SetOutput(arg); },
+      "Set output file name [arg].");
+    flags.AddOption('S', "--seed", [this](String arg){ SetRandomSeed(arg); },
+      "Set the random number seed with the following argument [arg]");
+    flags.AddOption('t', "--title", [this](String arg){ SetTitle(arg); },
+      "Specify the quiz/exam title to use in the generated file.");
+
+    flags.AddGroup("Output Format",
+      "These flags specify the output format to use.  If none are provided, the\n"
+      "extension on the output filename is used, or else QBL format is the default.\n");
+    flags.AddOption('d', "--d2l",     [this](){ SetFormat(Format::D2L); },
+      "Set output to be D2L / Brightspace csv quiz upload format.");
+    flags.AddOption('G', "--gradescope",     [this](){ SetFormat(Format::GRADESCOPE); },
+      "Set output to be in Latex format suitable for using with GradeScope.");
+    flags.AddOption('l', "--latex",   [this](){ SetFormat(Format::LATEX); },
+      "Set output to be Latex format.");
+    flags.AddOption('q', "--qbl",     [this](){ SetFormat(Format::QBL); },
+      "Set output to be QBL format.");
+    flags.AddOption('w', "--web",     [this](){ SetFormat(Format::WEB); },
+      "Set output to HTML/CSS/JS format.");
+    flags.AddOption('O', "--order",   [this](String arg){ SetOrder(arg); },
+      "Set the question order based on [arg] (\"random\", \"id\", or \"alpha\")");
+    flags.AddOption('c', "--compressed",   [this](){ compressed_format = true; },
+      "Make questions take less space (only works for GradeScope output).");
+    flags.AddOption('F', "--fragments",   [this](){ split_fragments = true; },
+      "Write each Latex/GradeScope question to its own file, \\input from the main file.");
+    flags.AddOption('K', "--part-kb",   [this](String arg){ part_kb = arg.As<size_t>(); },
+      "Split D2L output into part files of at most [arg] kilobytes each.");
+    flags.AddOption('Y', "--part-rows",   [this](String arg){ part_rows = arg.As<size_t>(); },
+      "Split D2L output into part files of at most [arg] rows each.");
+
+    flags.AddGroup("Question Specification",
+      "These options provide addition constraints as QBL decides which questions\n"
+      "should or should not be used in the output.\n");
+    flags.AddOption('i', "--include", [this](String arg){ _AddTags(include_tags, arg); },
+      "Include ALL questions with the following tag(s), not otherwise excluded.");
+    flags.AddOption('r', "--require", [this](String arg){ _AddTags(require_tags, arg); },
+      "Only questions with the following tag(s) can be included.");
+    flags.AddOption('s', "--sample",
+      [this](String tag_arg, String count_arg){ _AddTags(sample_tags, tag_arg, count_arg.As<size_t>()); },
+      "Specify tag(s) and the number of times they should be included.");
+    flags.AddOption('x', "--exclude", [this](String arg){ _AddTags(exclude_tags, arg); },
+      "Exclude all questions with following tag(s).");
+    flags.AddOption('L', "--log", [this](String arg){ log_filename = arg; },
+      "Log the IDs of the questions chosen to the file [arg].");
+    flags.AddOption('a', "--avoid", [this](String arg){ avoid_files.push_back(arg); },
+      "Provide a filename ([arg]) to avoid questions from; can previously be generated as log.");
+    flags.AddOption('M', "--manifest", [this](String arg){ manifest_filename = arg; },
+      "Record how to rebuild this exam exactly in file [arg]; see `QBL regen`.");
+  }
+
+  /// Configure this spec from a list of command-line style arguments (such as one line of a
+  /// batch file).  Returns any arguments that were not used by a flag.
+  emp::vector<String> ProcessArgs(const emp::vector<String> & args) {
+    emp::vector<std::string> arg_strings{"QBL"};
+    for (const String & arg : args) arg_strings.push_back(arg.str());
+    emp::vector<char *> arg_ptrs;
+    for (auto & arg : arg_strings) arg_ptrs.push_back(arg.data());
+    emp::FlagManager arg_flags(static_cast<int>(arg_ptrs.size()), arg_ptrs.data());
+    AddFlags(arg_flags);
+    arg_flags.Process();
+    return arg_flags.GetExtras();
+  }
+
+  /// Split a line into arguments at whitespace; quotes can be used to group words together.
+  static emp::vector<String> SplitArgs(const String & line) {
+    emp::vector<String> args;
+    String cur_arg;
+    bool in_arg = false;
+    char quote = '\0';
+    for (char c : line) {
+      if (quote) {
+        if (c == quote) quote = '\0';
+        else cur_arg += c;
+      }
+      else if (c == '"' || c == '\'') { quote = c; in_arg = true; }
+      else if (std::isspace(static_cast<unsigned char>(c))) {
+        if (in_arg) args.push_back(cur_arg);
+        cur_arg.clear();
+        in_arg = false;
+      }
+      else { cur_arg += c; in_arg = true; }
+    }
+    emp::notify::TestError(quote, "Unterminated quote in arguments: ", line);
+    if (in_arg) args.push_back(cur_arg);
+    return args;
+  }
+
+  void SetTitle(const String & in) { title = in; }
+
+  void SetFormat(Format f) {
+    emp::notify::TestWarning(format != Format::NONE,
+      "Setting format to '", GetFormatName(f),
+      "', but was already set to ", GetFormatName(format), ".");
+    format = f;
+  }
+
+  void SetOutput(String _filename, bool update_ok=false) {
+    if (base_filename.size() && !update_ok) {
+      emp::notify::Error("Only one output mode allowed at a time.");
+      exit(1);
+    }
+    std::cout << "Directing output to file '" << _filename << "'." << std::endl;
+    size_t slash_pos = _filename.RFind('/');
+    if (slash_pos != emp::String::npos) {
+      if (slash_pos+1 == _filename.size()) {
+        emp::notify::Error("Must provide a filename (not directory) for output.");
+        exit(1);
+      }
+      base_path = _filename.PopFixed(slash_pos+1);
+    }
+    size_t dot_pos = _filename.RFind('.');
+    base_filename = _filename.substr(0, dot_pos);
+    extension = _filename.View(dot_pos);
+    // If we don't have a format yet, set it based on the filename.
+    if (format == Format::NONE) {
+      if (extension == ".csv" || extension == ".d2l") format = Format::D2L;
+      if (extension == ".gscope") format = Format::GRADESCOPE;
+      else if (extension == ".html" || extension == ".htm") format = Format::WEB;
+      else if (extension == ".tex") format = Format::LATEX;
+      else if (extension == ".qbl") format = Format::QBL;
+    }
+  }
+
+  void SetGenerate(String _count) {
+    if (generate_count != 0) {
+      emp::notify::Error("Can only set one value for number of questions to generate.");
+    }
+    generate_count = _count.As<size_t>();
+    // If order hasn't been manually set, change it to random.
+    if (order == Order::DEFAULT) order = Order::RANDOM;
+  }
+
+  void SetRandomSeed(String _seed) {
+    random_seed = _seed.As<int>();
+    std::cout << "Using random seed: " << random_seed << std::endl;
+  }
+
+  void SetOrder(String _order) {
+    if (_order == "random") { order = Order::RANDOM; }
+    else if (_order == "id") { order = Order::ID; }
+    else if (_order == "alpha") { order = Order::ALPHABETIC; }
+    // @CAO - Other options are layout filenames
+  }
+
+  bool HasOutputFile() const { return base_filename.size(); }
+
+  /// Should the output be written as a series of size-limited part files?
+  bool IsSplitParts() const {
+    return format == Format::D2L && HasOutputFile() && (part_kb || part_rows);
+  }
+  String GetOutputFilename() const { return base_path + base_filename + extension; }
+
+  /// Directory (relative to the main output file) for per-question fragment files.
+  String GetFragmentDir() const { return base_filename + "_q"; }
+
+  /// Name (relative to the main output file, without extension) of one question's fragment.
+  String GetFragmentName(size_t q_num) const {
+    std::stringstream name;
+    name << GetFragmentDir() << "/q" << std::setw(4) << std::setfill('0') << q_num;
+    return name.str();
+  }
+
+  static String GetFormatName(Format id) {
+    switch (id) {
+    case Format::NONE: return "NONE";
+    case Format::D2L: return "D2L";
+    case Format::GRADESCOPE: return "GRADESCOPE";
+    case Format::LATEX: return "LATEX";
+    case Format::QBL: return "QBL";
+    case Format::WEB: return "WEB";
+    case Format::DEBUG: return "Debug";
+    };
+
+    return "Unknown!";
+  }
+
+  static Format GetFormatID(const String & name) {
+    for (Format id : {Format::QBL, Format::D2L, Format::GRADESCOPE, Format::LATEX,
+                      Format::WEB, Format::DEBUG}) {
+      if (GetFormatName(id) == name) return id;
+    }
+    return Format::NONE;
+  }
+
+  void PrintDebug(std::ostream & os=std::cout) const {
+   os << "Base filename: " << base_filename << "\n"
+      << "... extension: " << extension << "\n"
+      << "Output Format: " << GetFormatName(format) << "\n"
+      << "Include tags: " << emp::MakeLiteral(include_tags) << "\n"
+      << "Exclude tags: " << emp::MakeLiteral(exclude_tags) << "\n"
+      << "Required tags: " << emp::MakeLiteral(require_tags) << "\n"
+      << "Sampled tags: " << emp::MakeLiteral(sample_tags) << "\n";
+  }
+};
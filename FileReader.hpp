@@ -0,0 +1,289 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "emp/base/Ptr.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+#include "Scheduler.hpp"
+
+// io_uring support is optional; build with `make IO_URING=1` (requires liburing).
+#if defined(QBL_IO_URING) && __has_include(<liburing.h>)
+#include <liburing.h>
+#define QBL_HAS_IO_URING 1
+#else
+#define QBL_HAS_IO_URING 0
+#endif
+
+using emp::String;
+
+/// The path used to identify a file, no matter how it was referred to.
+static inline String CanonicalPath(const std::filesystem::path & path) {
+  std::error_code ec;
+  String canon_path = std::filesystem::weakly_canonical(path, ec).string();
+  if (ec) canon_path = path.lexically_normal().string();
+  return canon_path;
+}
+
+// Reads question files ahead of the parser.  Banks are often thousands of small files, so
+// loading is dominated by the latency of each open and read rather than by bandwidth; the
+// reader keeps many requests in flight (as batches submitted through io_uring when available,
+// otherwise as tasks on the shared scheduler) and the parser takes each file's contents when
+// it needs them.  Files that a prefetched file will /include are queued for reading as soon
+// as it arrives.
+class FileReader {
+private:
+  enum class State { QUEUED, READING, DONE };
+
+  struct Entry {
+    std::string content;     ///< Full contents of the file (once read).
+    State state = State::QUEUED;
+    bool ok = false;         ///< Was the file read successfully?
+  };
+
+  static constexpr size_t BATCH_SIZE = 64;   ///< Files per io_uring submission.
+
+  std::map<String, Entry> files;   ///< All files requested, by canonical path.
+  std::deque<String> to_read;      ///< Files waiting to be read.
+  bool stopping = false;
+  std::mutex mutex;
+  std::condition_variable work_cv;   ///< Signals the io_uring thread that there is work.
+  std::condition_variable done_cv;   ///< Signals Take() that a file has been read.
+  emp::Ptr<Scheduler> scheduler = nullptr;
+  Scheduler::TaskGroup read_tasks;   ///< Read tasks running on the scheduler.
+  size_t max_active = 1;           ///< Most read tasks to run at once.
+  size_t active_count = 0;         ///< Read tasks currently queued or running.
+  std::thread uring_thread;
+
+  // Claim up to max_count queued files to read into batch; with wait, blocks until there is at
+  // least one queued (or the reader is stopping).  The batch may still come back empty, since
+  // Take() can claim queued files itself.  Returns false once the reader is stopping.
+  bool _NextBatch(size_t max_count, bool wait, emp::vector<String> & batch) {
+    std::unique_lock lock(mutex);
+    if (wait) work_cv.wait(lock, [this](){ return stopping || to_read.size(); });
+    batch.clear();
+    while (to_read.size() && batch.size() < max_count && !stopping) {
+      Entry & entry = files[to_read.front()];
+      if (entry.state == State::QUEUED) {    // Take() may have read it already.
+        entry.state = State::READING;
+        batch.push_back(to_read.front());
+      }
+      to_read.pop_front();
+    }
+    return !stopping;
+  }
+
+  // Queue up any files that this one includes, so they are ready when the parser gets there.
+  void _PrefetchIncludes(const String & filename, const std::string & content) {
+    const std::filesystem::path dir = std::filesystem::path(filename.str()).parent_path();
+    size_t pos = 0;
+    while (pos < content.size()) {
+      size_t end = content.find('\n', pos);
+      if (end == std::string::npos) end = content.size();
+      std::string_view line(content.data() + pos, end - pos);
+      pos = end + 1;
+      if (!line.starts_with("/include")) continue;
+      line.remove_prefix(8);
+      if (line.empty() || !std::isspace(static_cast<unsigned char>(line[0]))) continue;
+      while (line.size() && std::isspace(static_cast<unsigned char>(line.front()))) line.remove_prefix(1);
+      while (line.size() && std::isspace(static_cast<unsigned char>(line.back()))) line.remove_suffix(1);
+      if (line.empty()) continue;
+      std::filesystem::path path(line);
+      Prefetch(CanonicalPath(path.is_relative() ? dir / path : path));
+    }
+  }
+
+  void _Finish(const String & filename, std::string && content, bool ok) {
+    if (ok) _PrefetchIncludes(filename, content);
+    {
+      std::lock_guard lock(mutex);
+      Entry & entry = files[filename];
+      entry.content = std::move(content);
+      entry.state = State::DONE;
+      entry.ok = ok;
+    }
+    done_cv.notify_all();
+  }
+
+  // Read a whole file from an open descriptor (continuing after any partial read).
+  static bool _ReadRest(int fd, std::string & content, size_t pos) {
+    while (pos < content.size()) {
+      const ssize_t count = pread(fd, content.data() + pos, content.size() - pos,
+                                  static_cast<off_t>(pos));
+      if (count <= 0) { content.resize(pos); return count == 0; }
+      pos += static_cast<size_t>(count);
+    }
+    return true;
+  }
+
+  static size_t _FileSize(int fd) {
+    struct stat st;
+    return (fstat(fd, &st) == 0) ? static_cast<size_t>(st.st_size) : 0;
+  }
+
+  void _ReadFile(const String & filename) {
+    std::string content;
+    const int fd = open(filename.c_str(), O_RDONLY);
+    bool ok = (fd >= 0);
+    if (ok) {
+      content.resize(_FileSize(fd));
+      ok = _ReadRest(fd, content, 0);
+      close(fd);
+    }
+    _Finish(filename, std::move(content), ok);
+  }
+
+  // Scheduler backend: each read task keeps reading queued files, one at a time, until there
+  // are none left.
+  void _RunReadTask() {
+    emp::vector<String> batch;
+    while (true) {
+      _NextBatch(1, false, batch);
+      if (batch.empty()) {
+        std::lock_guard lock(mutex);
+        if (to_read.empty() || stopping) { --active_count; return; }
+        continue;
+      }
+      _ReadFile(batch[0]);
+    }
+  }
+
+#if QBL_HAS_IO_URING
+  // Submit everything prepared so far, and record the result of each request by its index.
+  static void _SubmitAndReap(io_uring & ring, size_t count, emp::vector<int> & results) {
+    io_uring_submit_and_wait(&ring, static_cast<unsigned>(count));
+    for (size_t i = 0; i < count; ++i) {
+      io_uring_cqe * cqe = nullptr;
+      if (io_uring_wait_cqe(&ring, &cqe) < 0) break;
+      results[cqe->user_data] = cqe->res;
+      io_uring_cqe_seen(&ring, cqe);
+    }
+  }
+
+  // io_uring backend: one thread opens, reads, and closes a whole batch of files at a time.
+  void _RunUring() {
+    io_uring ring;
+    emp::vector<String> batch;
+    if (io_uring_queue_init(BATCH_SIZE, &ring, 0) < 0) {
+      while (_NextBatch(1, true, batch)) {
+        if (batch.size()) _ReadFile(batch[0]);
+      }
+      return;
+    }
+    while (_NextBatch(BATCH_SIZE, true, batch)) {
+      if (batch.empty()) continue;           // Take() claimed every file queued so far.
+      const size_t count = batch.size();
+
+      // Open all of the files.
+      emp::vector<int> fds(count, -1);
+      for (size_t i = 0; i < count; ++i) {
+        io_uring_sqe * sqe = io_uring_get_sqe(&ring);
+        io_uring_prep_openat(sqe, AT_FDCWD, batch[i].c_str(), O_RDONLY, 0);
+        sqe->user_data = i;
+      }
+      _SubmitAndReap(ring, count, fds);
+
+      // Read each of them in full.
+      emp::vector<std::string> contents(count);
+      emp::vector<int> read_sizes(count, -1);
+      size_t read_count = 0;
+      for (size_t i = 0; i < count; ++i) {
+        if (fds[i] < 0) continue;
+        contents[i].resize(_FileSize(fds[i]));
+        io_uring_sqe * sqe = io_uring_get_sqe(&ring);
+        io_uring_prep_read(sqe, fds[i], contents[i].data(),
+                           static_cast<unsigned>(contents[i].size()), 0);
+        sqe->user_data = i;
+        ++read_count;
+      }
+      _SubmitAndReap(ring, read_count, read_sizes);
+
+      // Finish any short reads directly, then close everything.
+      emp::vector<bool> ok(count, false);
+      emp::vector<int> close_results(count, 0);
+      size_t close_count = 0;
+      for (size_t i = 0; i < count; ++i) {
+        if (fds[i] < 0) continue;
+        ok[i] = read_sizes[i] >= 0 && _ReadRest(fds[i], contents[i], static_cast<size_t>(read_sizes[i]));
+        io_uring_sqe * sqe = io_uring_get_sqe(&ring);
+        io_uring_prep_close(sqe, fds[i]);
+        sqe->user_data = i;
+        ++close_count;
+      }
+      _SubmitAndReap(ring, close_count, close_results);
+
+      for (size_t i = 0; i < count; ++i) _Finish(batch[i], std::move(contents[i]), ok[i]);
+    }
+    io_uring_queue_exit(&ring);
+  }
+#endif
+
+public:
+  /// Start a reader that runs up to max_active reads at once on the scheduler.  With io_uring,
+  /// one thread of its own instead keeps whole batches in flight (it only waits on the ring).
+  FileReader(Scheduler & scheduler, size_t max_active)
+    : scheduler(&scheduler), max_active(std::max<size_t>(max_active, 1)) {
+#if QBL_HAS_IO_URING
+    uring_thread = std::thread([this](){ _RunUring(); });
+#endif
+  }
+  FileReader(const FileReader &) = delete;
+  ~FileReader() {
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    work_cv.notify_all();
+    if (uring_thread.joinable()) uring_thread.join();
+    scheduler->Wait(read_tasks);
+  }
+
+  static constexpr bool UsesIOUring() { return QBL_HAS_IO_URING; }
+
+  /// Start reading a file (by canonical path) if it has not already been requested.
+  void Prefetch(const String & filename) {
+    bool start_task = false;
+    {
+      std::lock_guard lock(mutex);
+      if (files.contains(filename)) return;
+      files[filename];
+      to_read.push_back(filename);
+      if (!QBL_HAS_IO_URING && active_count < max_active) { ++active_count; start_task = true; }
+    }
+    if (QBL_HAS_IO_URING) work_cv.notify_one();
+    else if (start_task) scheduler->Run(read_tasks, [this](){ _RunReadTask(); });
+  }
+
+  /// Move the contents of a prefetched file into `content`, waiting for the read to finish if
+  /// needed.  Returns false if the file was never requested or could not be read.
+  bool Take(const String & filename, std::string & content) {
+    std::unique_lock lock(mutex);
+    auto it = files.find(filename);
+    if (it == files.end()) return false;
+    if (it->second.state == State::QUEUED) {    // Not started yet; read it here instead.
+      it->second.state = State::READING;
+      lock.unlock();
+      _ReadFile(filename);
+      lock.lock();
+    }
+    done_cv.wait(lock, [&it](){ return it->second.state == State::DONE; });
+    if (!it->second.ok) return false;
+    content = std::move(it->second.content);
+    it->second.ok = false;    // Contents have been handed off.
+    return true;
+  }
+};
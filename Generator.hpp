@@ -0,0 +1,82 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <utility>
+
+// A lazy sequence produced by a coroutine (a minimal stand-in for C++23's std::generator).
+// The coroutine runs only when the caller asks for the next value, and each value it yields
+// is passed by reference, so it is only valid until the next one is requested.  Stopping
+// early (or destroying the generator) simply discards the suspended coroutine.
+//
+//   Generator<int> Count(int max) { for (int i = 0; i < max; ++i) co_yield i; }
+//   for (int i : Count(10)) { ... }
+template <typename T>
+class Generator {
+public:
+  struct promise_type {
+    const T * value = nullptr;         ///< Most recent value yielded (owned by the coroutine).
+    std::exception_ptr exception = nullptr;
+
+    Generator get_return_object() { return Generator(handle_t::from_promise(*this)); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(const T & in) noexcept { value = &in; return {}; }
+    void return_void() noexcept { }
+    void unhandled_exception() { exception = std::current_exception(); }
+
+    // Generators produce values; they cannot wait on anything else.
+    template <typename U> std::suspend_never await_transform(U &&) = delete;
+  };
+
+  using handle_t = std::coroutine_handle<promise_type>;
+
+  class iterator {
+  private:
+    handle_t handle = nullptr;
+
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() { }
+    explicit iterator(handle_t in) : handle(in) { }
+
+    const T & operator*() const { return *handle.promise().value; }
+    const T * operator->() const { return handle.promise().value; }
+    iterator & operator++() { _Resume(handle); return *this; }
+    void operator++(int) { ++*this; }
+    bool operator==(std::default_sentinel_t) const { return !handle || handle.done(); }
+  };
+
+private:
+  handle_t handle = nullptr;
+
+  explicit Generator(handle_t in) : handle(in) { }
+
+  static void _Resume(handle_t handle) {
+    handle.resume();
+    if (handle.promise().exception) std::rethrow_exception(handle.promise().exception);
+  }
+
+public:
+  Generator(const Generator &) = delete;
+  Generator(Generator && in) : handle(std::exchange(in.handle, nullptr)) { }
+  Generator & operator=(Generator && in) {
+    if (this != &in) {
+      if (handle) handle.destroy();
+      handle = std::exchange(in.handle, nullptr);
+    }
+    return *this;
+  }
+  ~Generator() { if (handle) handle.destroy(); }
+
+  /// Run the coroutine up to its first value; a generator can only be iterated once.
+  iterator begin() {
+    if (handle) _Resume(handle);
+    return iterator(handle);
+  }
+  std::default_sentinel_t end() const { return std::default_sentinel; }
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "emp/tools/String.hpp"
+
+// A simple streaming 64-bit FNV-1a hash.  Results are stable across runs and platforms, so
+// they can be stored in files and compared later.
+class Hasher {
+private:
+  uint64_t value = 14695981039346656037ull;
+
+public:
+  Hasher() { }
+
+  Hasher & AddBytes(const void * data, size_t size) {
+    const unsigned char * bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+      value ^= bytes[i];
+      value *= 1099511628211ull;
+    }
+    return *this;
+  }
+
+  // Strings are length-prefixed so that ("ab","c") and ("a","bc") hash differently.
+  Hasher & Add(std::string_view in) {
+    Add(static_cast<uint64_t>(in.size()));
+    return AddBytes(in.data(), in.size());
+  }
+  Hasher & Add(const emp::String & in) { return Add(std::string_view(in.str())); }
+  Hasher & Add(const char * in) { return Add(std::string_view(in)); }
+
+  template <typename T> requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+  Hasher & Add(T in) {
+    // Widen to a fixed size, little-endian, so results do not depend on the platform.
+    uint64_t val = static_cast<uint64_t>(in);
+    unsigned char bytes[8];
+    for (size_t i = 0; i < 8; ++i) bytes[i] = static_cast<unsigned char>(val >> (8*i));
+    return AddBytes(bytes, 8);
+  }
+
+  template <typename T1, typename T2, typename... Ts>
+  Hasher & Add(const T1 & in1, const T2 & in2, const Ts &... extras) {
+    Add(in1);
+    return Add(in2, extras...);
+  }
+
+  uint64_t Get() const { return value; }
+
+  /// Provide the hash as a fixed-width (16 character) hex string.
+  emp::String GetHex() const {
+    constexpr const char * digits = "0123456789abcdef";
+    emp::String out = std::string(16, '0');
+    for (size_t i = 0; i < 16; ++i) out[15-i] = digits[(value >> (4*i)) & 15];
+    return out;
+  }
+};
+
+/// Hash any number of values in one call.
+template <typename... Ts>
+static inline uint64_t HashValues(const Ts &... values) {
+  return Hasher().Add(values...).Get();
+}
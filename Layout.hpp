@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+// Tools to estimate how much horizontal space text takes on a Latex page and to pack items
+// (such as answer options) into lines.  All widths are in tenths of a point at 10pt.
+
+namespace layout {
+  // Widths of printable ASCII characters in Computer Modern Roman (cmr10).
+  static constexpr std::array<uint8_t, 128> MakeRomanWidths() {
+    std::array<uint8_t, 128> widths{};
+    for (auto & w : widths) w = 50;           // Default for anything unlisted.
+    const char * lower = "abcdefghijklmnopqrstuvwxyz";
+    constexpr uint8_t lower_w[] = { 50, 56, 44, 56, 44, 31, 50, 56, 28, 31, 53, 28, 83,
+                                    56, 50, 56, 53, 39, 39, 39, 56, 53, 72, 53, 53, 44 };
+    const char * upper = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    constexpr uint8_t upper_w[] = { 75, 71, 72, 76, 68, 65, 79, 75, 36, 51, 78, 63, 92,
+                                    75, 78, 68, 78, 74, 56, 72, 75, 75, 103, 75, 75, 61 };
+    for (size_t i = 0; i < 26; ++i) {
+      widths[static_cast<size_t>(lower[i])] = lower_w[i];
+      widths[static_cast<size_t>(upper[i])] = upper_w[i];
+    }
+    for (char c = '0'; c <= '9'; ++c) widths[static_cast<size_t>(c)] = 50;
+    const char * narrow = ".,:;!'`|[]";
+    for (const char * c = narrow; *c; ++c) widths[static_cast<size_t>(*c)] = 28;
+    widths[' '] = 33;
+    widths['('] = widths[')'] = 39;
+    widths['-'] = 33;
+    widths['?'] = 47;
+    widths['+'] = widths['='] = widths['<'] = widths['>'] = 78;
+    widths['%'] = 83;
+    widths['&'] = 78;
+    widths['#'] = 83;
+    widths['@'] = 78;
+    widths['_'] = 50;
+    return widths;
+  }
+
+  static constexpr std::array<uint8_t, 128> roman_widths = MakeRomanWidths();
+  static constexpr uint8_t mono_width = 53;       // Every character in cmtt10.
+  static constexpr uint8_t other_width = 60;      // Non-ASCII characters (symbols, etc.)
+
+  static constexpr size_t line_width = 4500;      // \linewidth minus the hanging indent.
+  static constexpr size_t bubble_width = 150;     // Answer bubble before each option.
+  static constexpr size_t wide_gap = 300;         // \hspace*{3em} between options on one line.
+  static constexpr size_t narrow_gap = 50;        // \hspace*{.5em} between compressed options.
+}
+
+/// Estimate the printed width of a line of QBL text (before conversion to Latex): text in
+/// backticks is in a fixed-width font, escapes count as the one character they produce, and
+/// multi-line text is as wide as its widest line.
+static inline size_t TextWidth(const emp::String & text) {
+  size_t max_width = 0;
+  size_t width = 0;
+  bool in_code = text.HasPrefix("    ");
+  char scan_to = '\0';         // Inside \&...; or \<...> escape?
+  bool start_scan = false;
+  for (char c : text) {
+    const unsigned char uc = static_cast<unsigned char>(c);
+    if (scan_to) {
+      if (c == scan_to) {
+        if (c == ';') width += layout::other_width;   // An entity prints one symbol.
+        scan_to = '\0';
+      }
+      continue;
+    }
+    if (start_scan) {
+      start_scan = false;
+      if (c == '&') { scan_to = ';'; continue; }
+      if (c == '<') { scan_to = '>'; continue; }
+      if (c == 'n') { max_width = std::max(max_width, width); width = 0; continue; }
+    }
+    else if (c == '\\') { start_scan = true; continue; }
+    else if (c == '`') { in_code = !in_code; continue; }
+    else if (c == '\n') {
+      max_width = std::max(max_width, width);
+      width = 0;
+      in_code = false;
+      continue;
+    }
+
+    if (uc >= 0x80 && uc < 0xC0) continue;          // UTF-8 continuation byte.
+    if (in_code) width += layout::mono_width;
+    else if (uc >= 0x80) width += layout::other_width;
+    else width += layout::roman_widths[uc];
+  }
+  return std::max(max_width, width);
+}
+
+/// Break a sequence of items (with the provided widths) into lines no wider than line_width,
+/// adding `gap` after each item.  Uses as few lines as possible and, among those layouts, the
+/// one with the most even line lengths (least total squared slack, ignoring the last line).
+/// Returns the index of the first item on each line.
+static inline emp::vector<size_t> PackLines(const emp::vector<size_t> & widths,
+                                            size_t line_width, size_t gap) {
+  const size_t num_items = widths.size();
+  if (num_items == 0) return {};
+
+  // best_cost[i] / best_lines[i] describe the best layout for items i to the end.
+  constexpr double MAX_COST = std::numeric_limits<double>::max();
+  emp::vector<double> best_cost(num_items+1, MAX_COST);
+  emp::vector<size_t> best_lines(num_items+1, num_items+1);
+  emp::vector<size_t> next_line(num_items+1, num_items);
+  best_cost[num_items] = 0.0;
+  best_lines[num_items] = 0;
+
+  for (size_t start = num_items; start-- > 0;) {
+    size_t cur_width = 0;
+    for (size_t end = start; end < num_items; ++end) {   // Line holds items start..end
+      cur_width += widths[end] + gap;
+      // Always allow one item per line, even if it is too wide.
+      if (cur_width > line_width && end > start) break;
+      const size_t lines = best_lines[end+1] + 1;
+      double slack = (end+1 == num_items) ? 0.0
+                   : static_cast<double>(line_width) - static_cast<double>(cur_width);
+      if (slack < 0.0) slack = 0.0;
+      const double cost = best_cost[end+1] + slack * slack;
+      if (lines < best_lines[start] || (lines == best_lines[start] && cost < best_cost[start])) {
+        best_lines[start] = lines;
+        best_cost[start] = cost;
+        next_line[start] = end+1;
+      }
+    }
+  }
+
+  emp::vector<size_t> line_starts;
+  for (size_t pos = 0; pos < num_items; pos = next_line[pos]) line_starts.push_back(pos);
+  return line_starts;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#include "emp/base/vector.hpp"
+
+// Drives a fixed number of requests through a request function from several client threads at
+// once, the way a resident QBL would be used, and reports throughput and latency percentiles.
+// Each request reports how long it spent choosing questions and how long rendering them, so
+// a capacity regression can be traced to one side or the other.
+class LoadTest {
+public:
+  struct Timing {
+    double select_ms = 0.0;   ///< Selecting questions and generating their variants.
+    double render_ms = 0.0;   ///< Rendering the exam to its output format.
+  };
+
+private:
+  emp::vector<Timing> timings;   ///< Time taken by each request.
+  size_t client_count = 0;
+  double wall_ms = 0.0;          ///< Time to complete every request.
+
+  // Nearest-rank percentile (p in [0,1]) of values that are already sorted.
+  static double _Percentile(const emp::vector<double> & sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    const size_t rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+  }
+
+  void _PrintRow(std::ostream & os, const char * name, emp::vector<double> values) const {
+    std::sort(values.begin(), values.end());
+    os << "  " << std::left << std::setw(10) << name << std::right;
+    for (double p : {0.5, 0.99, 0.999}) os << std::setw(10) << _Percentile(values, p);
+    os << std::setw(10) << (values.empty() ? 0.0 : values.back()) << '\n';
+  }
+
+public:
+  /// Run fun(request_id) -> Timing for each request in [0, request_count), with client_count
+  /// threads each taking the next request as soon as their last one finishes.
+  template <typename FUN_T>
+  void Run(size_t request_count, size_t in_client_count, FUN_T && fun) {
+    client_count = std::max<size_t>(in_client_count, 1);
+    timings.assign(request_count, Timing{});
+    std::atomic<size_t> next_request = 0;
+    auto client = [&](){
+      for (size_t id = next_request++; id < request_count; id = next_request++) {
+        timings[id] = fun(id);
+      }
+    };
+
+    const auto start_time = std::chrono::steady_clock::now();
+    emp::vector<std::thread> clients;
+    for (size_t i = 1; i < client_count; ++i) clients.emplace_back(client);
+    client();
+    for (auto & thread : clients) thread.join();
+    const std::chrono::duration<double, std::milli> duration =
+      std::chrono::steady_clock::now() - start_time;
+    wall_ms = duration.count();
+  }
+
+  void PrintReport(std::ostream & os=std::cout) const {
+    emp::vector<double> total_ms, select_ms, render_ms;
+    for (const Timing & timing : timings) {
+      total_ms.push_back(timing.select_ms + timing.render_ms);
+      select_ms.push_back(timing.select_ms);
+      render_ms.push_back(timing.render_ms);
+    }
+    const double seconds = wall_ms / 1000.0;
+    os << std::fixed << std::setprecision(3)
+       << "Load test: " << timings.size() << " requests from " << client_count << " clients in "
+       << seconds << " s\n"
+       << "Throughput: " << std::setprecision(1)
+       << (seconds > 0.0 ? static_cast<double>(timings.size()) / seconds : 0.0)
+       << " requests/s\n"
+       << std::setprecision(3)
+       << "Latency (ms)       p50       p99      p999       max\n";
+    _PrintRow(os, "total", total_ms);
+    _PrintRow(os, "selection", select_ms);
+    _PrintRow(os, "render", render_ms);
+    os.flush();
+  }
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "emp/base/notify.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+using emp::String;
+
+// Everything needed to regenerate an exam byte-for-byte from a snapshot of its question bank:
+// which questions were used (in order), how each variant was generated, and how the exam was
+// rendered.  Manifests are a few lines of text, so they can be archived in place of the exams
+// themselves; `QBL regen [manifest]` rebuilds the output from one.
+//
+// Each line is a keyword followed by its value, e.g.:
+//   qbl_version 0.1
+//   render_version 4
+//   seed 12345
+//   format LATEX
+//   title Quiz 1
+//   bank_file questions/week1.qbl
+//   bank_hash 3f2a9c0d11e8b7a4
+//   require week1
+//   sample loops loops arrays
+//   asset_dir assets
+//   template latex_header 77c2e0a1954b3d86 headers/quiz.tex
+//   question 17 90ab44f10c2d3e5f alt 3 0 2
+//   rejected 4 5be0c1d2e3f40718
+// Lines starting with '%' are comments.
+class ExamManifest {
+public:
+  struct Entry {
+    size_t id;          ///< ID of the question in the bank when the exam was made.
+    uint64_t hash;      ///< Identity of the question in the bank; see Question::GetIdentityHash()
+    String variant;     ///< Choices made when generating it; see Question::GetVariant()
+  };
+
+  struct TemplateEntry {
+    String name;        ///< Name of the template replaced (see TemplateSet).
+    uint64_t hash;      ///< Hash of the text it was replaced with.
+    String filename;    ///< File that text was loaded from.
+  };
+
+  String qbl_version = "";
+  size_t render_version = 0;
+  int seed = -1;                       ///< Random seed used to select and generate questions.
+  String format = "";                  ///< Output format name (see ExamSpec::GetFormatName)
+  String title = "";
+  String output = "";                  ///< Output file the exam was written to.
+  bool compressed = false;             ///< Was compressed GradeScope output used?
+  bool fragments = false;              ///< Was each question written to its own file?
+  emp::vector<String> include_tags;    ///< Constraints the questions were selected with,
+  emp::vector<String> exclude_tags;    ///<   needed to choose replacements for them later
+  emp::vector<String> require_tags;    ///<   (see `QBL replace`).
+  emp::vector<String> sample_tags;
+  emp::vector<String> avoid_files;
+  String asset_dir = "";               ///< Directory assets were placed in (see -A).
+  emp::vector<TemplateEntry> templates;  ///< Output templates replaced with -T.
+  emp::vector<String> bank_files;      ///< Question files loaded (in order).
+  uint64_t bank_hash = 0;              ///< Snapshot hash of the full question bank.
+  emp::vector<Entry> questions;        ///< Questions in the exam, in order.
+  emp::vector<Entry> rejected;         ///< Questions vetoed by `QBL replace` (no variant).
+
+  static String ToHex(uint64_t value) {
+    std::stringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << value;
+    return ss.str();
+  }
+
+  static uint64_t FromHex(const String & hex) {
+    return std::stoull(hex.str(), nullptr, 16);
+  }
+
+  static void WriteTags(std::ostream & os, const String & key, const emp::vector<String> & tags) {
+    if (tags.empty()) return;
+    os << key;
+    for (const String & tag : tags) os << ' ' << tag;
+    os << "\n";
+  }
+
+  static void LoadTags(String line, emp::vector<String> & tags) {
+    while (!line.OnlyWhitespace()) tags.push_back(line.PopWord());
+  }
+
+  void Write(std::ostream & os) const {
+    os << "% QBL exam manifest; rebuild the exam with `QBL regen [this file]`.\n"
+       << "qbl_version " << qbl_version << "\n"
+       << "render_version " << render_version << "\n"
+       << "seed " << seed << "\n"
+       << "format " << format << "\n"
+       << "title " << title << "\n";
+    if (output.size()) os << "output " << output << "\n";
+    os << "compressed " << compressed << "\n"
+       << "fragments " << fragments << "\n";
+    for (const String & filename : bank_files) os << "bank_file " << filename << "\n";
+    os << "bank_hash " << ToHex(bank_hash) << "\n";
+    WriteTags(os, "include", include_tags);
+    WriteTags(os, "exclude", exclude_tags);
+    WriteTags(os, "require", require_tags);
+    WriteTags(os, "sample", sample_tags);
+    for (const String & filename : avoid_files) os << "avoid " << filename << "\n";
+    if (asset_dir.size()) os << "asset_dir " << asset_dir << "\n";
+    for (const TemplateEntry & entry : templates) {
+      os << "template " << entry.name << ' ' << ToHex(entry.hash) << ' ' << entry.filename << "\n";
+    }
+    for (const Entry & entry : questions) {
+      os << "question " << entry.id << ' ' << ToHex(entry.hash);
+      if (entry.variant.size()) os << ' ' << entry.variant;
+      os << "\n";
+    }
+    for (const Entry & entry : rejected) {
+      os << "rejected " << entry.id << ' ' << ToHex(entry.hash) << "\n";
+    }
+  }
+
+  /// Load a manifest from a file; returns false (after reporting the problem) on failure.
+  bool Load(const String & filename) {
+    std::ifstream file(filename.str());
+    if (!file) {
+      emp::notify::Error("Unable to open manifest file '", filename, "'.");
+      return false;
+    }
+    std::string line_str;
+    for (size_t line_num = 1; std::getline(file, line_str); ++line_num) {
+      String line(line_str);
+      if (line.OnlyWhitespace() || line.HasPrefix("%")) continue;
+      const String key = line.PopWord();
+      line.TrimWhitespace();
+      try {
+        if (key == "qbl_version") qbl_version = line;
+        else if (key == "render_version") render_version = std::stoull(line.str());
+        else if (key == "seed") seed = std::stoi(line.str());
+        else if (key == "format") format = line;
+        else if (key == "title") title = line;
+        else if (key == "output") output = line;
+        else if (key == "compressed") compressed = (line == "1");
+        else if (key == "fragments") fragments = (line == "1");
+        else if (key == "bank_file") bank_files.push_back(line);
+        else if (key == "bank_hash") bank_hash = FromHex(line);
+        else if (key == "include") LoadTags(line, include_tags);
+        else if (key == "exclude") LoadTags(line, exclude_tags);
+        else if (key == "require") LoadTags(line, require_tags);
+        else if (key == "sample") LoadTags(line, sample_tags);
+        else if (key == "avoid") avoid_files.push_back(line);
+        else if (key == "asset_dir") asset_dir = line;
+        else if (key == "template") {
+          TemplateEntry entry;
+          entry.name = line.PopWord();
+          entry.hash = FromHex(line.PopWord());
+          entry.filename = line.TrimWhitespace();
+          templates.push_back(entry);
+        }
+        else if (key == "question") {
+          Entry entry;
+          entry.id = std::stoull(line.PopWord().str());
+          entry.hash = FromHex(line.PopWord());
+          entry.variant = line.TrimWhitespace();
+          questions.push_back(entry);
+        }
+        else if (key == "rejected") {
+          Entry entry;
+          entry.id = std::stoull(line.PopWord().str());
+          entry.hash = FromHex(line.PopWord());
+          rejected.push_back(entry);
+        }
+        else {
+          emp::notify::Warning("Manifest '", filename, "' line ", line_num,
+                               ": unknown keyword '", key, "'; ignoring.");
+        }
+      } catch (const std::exception &) {
+        emp::notify::Error("Manifest '", filename, "' line ", line_num, ": invalid value for '",
+                           key, "'.");
+        return false;
+      }
+    }
+    return true;
+  }
+};
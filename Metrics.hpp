@@ -0,0 +1,211 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "emp/base/Ptr.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+#include "OutputFile.hpp"
+
+using emp::String;
+
+// Operational metrics for long-running QBL processes (preview servers, load tests, and large
+// batches), written in the Prometheus text format.  The time taken by each phase of work goes
+// into latency histograms kept per thread: each thread updates only its own shard of counters
+// (with relaxed atomics), so recording a time never contends with other threads, and shards
+// are only summed when the metrics are scraped.  Everything else (bank size, cache hits,
+// memory, worker time) is read from its owner at scrape time by the provided gauge function.
+// Only one Metrics object should record per process, since each thread caches its shard.
+class Metrics {
+public:
+  enum class Phase {
+    LOAD=0,     ///< Loading the question bank.
+    SELECT,     ///< Choosing questions for an exam and generating their variants.
+    RENDER,     ///< Rendering an exam to its output format.
+    REQUEST,    ///< Serving a whole exam request (selection and rendering, or a cache hit).
+    RELOAD      ///< Reloading the bank after an edit (preview server).
+  };
+  static constexpr size_t NUM_PHASES = 5;
+
+  /// Upper bounds (in milliseconds) of the histogram buckets, before the final +Inf bucket.
+  static constexpr std::array<double, 13> bucket_ms =
+    { 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000 };
+
+private:
+  using counts_t = std::array<std::atomic<uint64_t>, bucket_ms.size() + 1>;
+
+  struct Shard {
+    std::array<counts_t, NUM_PHASES> counts{};                ///< Count in each bucket.
+    std::array<std::atomic<uint64_t>, NUM_PHASES> sum_ns{};   ///< Total time of each phase.
+  };
+
+  emp::vector<emp::Ptr<Shard>> shards;           ///< One per thread that has recorded a time.
+  mutable std::mutex mutex;                      ///< Guards the list of shards (not the counts).
+  std::function<void(std::ostream &)> gauge_fun; ///< Writes metrics read at scrape time.
+
+  String filename = "";                          ///< File to keep rewriting (if any).
+  std::thread file_thread;
+  std::mutex file_mutex;
+  std::condition_variable file_cv;               ///< Wakes the file thread to stop.
+  bool stopping = false;
+
+  static inline thread_local const Metrics * tl_owner = nullptr;
+  static inline thread_local emp::Ptr<Shard> tl_shard = nullptr;
+
+  Shard & _GetShard() {
+    if (tl_owner != this) {
+      std::lock_guard lock(mutex);
+      shards.push_back(emp::NewPtr<Shard>());
+      tl_shard = shards.back();
+      tl_owner = this;
+    }
+    return *tl_shard;
+  }
+
+  static std::string_view _PhaseName(size_t phase_id) {
+    constexpr std::string_view names[] = { "load", "select", "render", "request", "reload" };
+    return names[phase_id];
+  }
+
+  // Counters are written as integers; other values with enough digits to round-trip.
+  static void _WriteValue(std::ostream & os, double value) {
+    if (value == std::floor(value) && std::abs(value) < 1e15) os << static_cast<int64_t>(value);
+    else {
+      std::stringstream ss;
+      ss.precision(9);
+      ss << value;
+      os << ss.str();
+    }
+  }
+
+public:
+  Metrics() { }
+  Metrics(const Metrics &) = delete;
+  ~Metrics() {
+    Stop();
+    for (auto shard : shards) shard.Delete();
+  }
+
+  /// Provide a function to write the metrics that are read at scrape time (see WriteMetric).
+  void SetGaugeFun(std::function<void(std::ostream &)> fun) { gauge_fun = fun; }
+
+  /// Record the time taken by one instance of a phase.
+  void Observe(Phase phase, double ms) {
+    Shard & shard = _GetShard();
+    const size_t phase_id = static_cast<size_t>(phase);
+    const size_t bucket = static_cast<size_t>(
+      std::lower_bound(bucket_ms.begin(), bucket_ms.end(), ms) - bucket_ms.begin());
+    shard.counts[phase_id][bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum_ns[phase_id].fetch_add(static_cast<uint64_t>(std::max(ms, 0.0) * 1e6),
+                                     std::memory_order_relaxed);
+  }
+
+  /// Resident memory of this process in bytes (0 if it cannot be found).
+  static size_t GetProcessMemory() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0, resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) return 0;
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  }
+
+  /// Write one metric family: its help and type, then one sample for each set of labels
+  /// (e.g. `cache="render"`, or empty for none).
+  static void WriteMetric(std::ostream & os, std::string_view name, std::string_view type,
+                          std::string_view help,
+                          const emp::vector<std::pair<std::string, double>> & samples) {
+    os << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+    for (const auto & [labels, value] : samples) {
+      os << name;
+      if (labels.size()) os << '{' << labels << '}';
+      os << ' ';
+      _WriteValue(os, value);
+      os << '\n';
+    }
+  }
+
+  /// Write every metric in the Prometheus text format.
+  void Write(std::ostream & os) const {
+    std::array<std::array<uint64_t, bucket_ms.size() + 1>, NUM_PHASES> counts{};
+    std::array<uint64_t, NUM_PHASES> sum_ns{};
+    {
+      std::lock_guard lock(mutex);
+      for (auto shard : shards) {
+        for (size_t phase_id = 0; phase_id < NUM_PHASES; ++phase_id) {
+          for (size_t bucket = 0; bucket <= bucket_ms.size(); ++bucket) {
+            counts[phase_id][bucket] +=
+              shard->counts[phase_id][bucket].load(std::memory_order_relaxed);
+          }
+          sum_ns[phase_id] += shard->sum_ns[phase_id].load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    os << "# HELP qbl_phase_duration_seconds Time taken by each phase of work.\n"
+       << "# TYPE qbl_phase_duration_seconds histogram\n";
+    for (size_t phase_id = 0; phase_id < NUM_PHASES; ++phase_id) {
+      const std::string_view phase = _PhaseName(phase_id);
+      uint64_t total = 0;
+      for (size_t bucket = 0; bucket <= bucket_ms.size(); ++bucket) {
+        total += counts[phase_id][bucket];
+        os << "qbl_phase_duration_seconds_bucket{phase=\"" << phase << "\",le=\"";
+        if (bucket < bucket_ms.size()) _WriteValue(os, bucket_ms[bucket] / 1000.0);
+        else os << "+Inf";
+        os << "\"} " << total << '\n';
+      }
+      os << "qbl_phase_duration_seconds_sum{phase=\"" << phase << "\"} ";
+      _WriteValue(os, static_cast<double>(sum_ns[phase_id]) / 1e9);
+      os << "\nqbl_phase_duration_seconds_count{phase=\"" << phase << "\"} " << total << '\n';
+    }
+    if (gauge_fun) gauge_fun(os);
+  }
+
+  /// Write every metric to a file (replacing it in one step, so readers never see a partial file).
+  void WriteFile(const String & out_filename) const {
+    std::stringstream ss;
+    Write(ss);
+    WriteIfChanged(out_filename, ss.str());
+  }
+
+  /// Rewrite a metrics file every period_ms on a background thread, until Stop().  Only use
+  /// this while everything the gauge function reads is safe to read from another thread.
+  void StartFile(const String & out_filename, int period_ms=1000) {
+    filename = out_filename;
+    file_thread = std::thread([this, period_ms](){
+      std::unique_lock lock(file_mutex);
+      while (!file_cv.wait_for(lock, std::chrono::milliseconds(period_ms),
+                               [this](){ return stopping; })) {
+        WriteFile(filename);
+      }
+    });
+  }
+
+  /// Stop rewriting the metrics file (if started), writing it one last time.
+  void Stop() {
+    if (!file_thread.joinable()) return;
+    {
+      std::lock_guard lock(file_mutex);
+      stopping = true;
+    }
+    file_cv.notify_all();
+    file_thread.join();
+    WriteFile(filename);
+  }
+};
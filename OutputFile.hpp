@@ -0,0 +1,99 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+#include "emp/base/notify.hpp"
+#include "emp/tools/String.hpp"
+
+#include "Hash.hpp"
+
+// Output files are only replaced when their content changes, so tools that watch timestamps
+// (make, rsync, LaTeX builds) do not redo work.  Each file has a small sidecar recording the
+// hash of the content last written, so most changes are found without reading the old file
+// (which is still compared before it is left alone).  New content is written to a temporary
+// file and renamed into place so readers never see a partially written file.
+
+static inline emp::String HashSidecarName(const emp::String & filename) {
+  return filename + ".qblhash";
+}
+
+/// Does the file hold exactly the provided content?  Read in blocks, stopping at the first
+/// difference.
+static inline bool FileHasContent(const emp::String & filename, std::string_view content) {
+  std::ifstream in(filename.str(), std::ios::binary);
+  if (!in) return false;
+  char buffer[65536];
+  size_t pos = 0;
+  while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+    const std::string_view block(buffer, static_cast<size_t>(in.gcount()));
+    if (content.substr(pos, block.size()) != block) return false;
+    pos += block.size();
+  }
+  return pos == content.size();
+}
+
+/// Write content to a file unless it already holds exactly that content (which is viewed,
+/// not copied).  Returns true if the file was (re)written.
+static inline bool WriteIfChanged(const emp::String & filename, std::string_view content) {
+  const emp::String new_hash = Hasher().Add(content).GetHex();
+  const emp::String sidecar = HashSidecarName(filename);
+
+  // If the sidecar matches and the file is still the size we wrote, compare the bytes too,
+  // since the file may have been edited since without changing its size.
+  std::error_code ec;
+  if (std::filesystem::file_size(filename.str(), ec) == content.size() && !ec) {
+    std::ifstream hash_file(sidecar.str());
+    std::string old_hash;
+    if (hash_file >> old_hash && old_hash == new_hash.str() &&
+        FileHasContent(filename, content)) return false;
+  }
+
+  const emp::String tmp_filename = filename + ".tmp";
+  {
+    std::ofstream out(tmp_filename.str(), std::ios::binary | std::ios::trunc);
+    out.write(content.data(), static_cast<std::streamsize>(content.size()));
+    if (!out) {
+      emp::notify::Error("Unable to write output file '", filename, "'.");
+      return false;
+    }
+  }
+  std::filesystem::rename(tmp_filename.str(), filename.str(), ec);
+  if (ec) {
+    emp::notify::Error("Unable to replace output file '", filename, "': ", ec.message());
+    return false;
+  }
+  std::ofstream(sidecar.str()) << new_hash << '\n';
+  return true;
+}
+
+// An output stream that renders into a string it keeps between uses; Clear() empties the
+// text but keeps its memory, so rendering many exams in turn does not reallocate.
+class RenderBuffer : public std::ostream {
+private:
+  struct StringBuf : public std::streambuf {
+    std::string text;
+
+    int_type overflow(int_type c) override {
+      if (c != traits_type::eof()) text.push_back(static_cast<char>(c));
+      return c;
+    }
+    std::streamsize xsputn(const char * s, std::streamsize count) override {
+      text.append(s, static_cast<size_t>(count));
+      return count;
+    }
+  };
+
+  StringBuf buffer;
+
+public:
+  RenderBuffer() : std::ostream(nullptr) { rdbuf(&buffer); }
+  RenderBuffer(const RenderBuffer &) = delete;
+
+  void Clear() { buffer.text.clear(); clear(); }
+  std::string_view View() const { return buffer.text; }
+};
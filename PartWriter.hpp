@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "emp/base/notify.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+#include "OutputFile.hpp"
+#include "Scheduler.hpp"
+
+using emp::String;
+
+// Writes a long output as numbered part files (quiz-part001.csv, quiz-part002.csv, ...) for
+// importers that reject files above a size or row limit.  Text is added one record at a time
+// (all of the rows for one question) and a record is never split across parts.  Each part is
+// handed to the scheduler to write as soon as it is full, while later parts are still being
+// filled; at most one part per thread is waiting to be written at once, so memory use does
+// not grow with the size of the output.  Finish() writes a small index listing the parts.
+class PartWriter {
+public:
+  struct Part {
+    String filename;          ///< Name of the part file (relative to the index).
+    size_t records = 0;       ///< Questions in this part.
+    size_t rows = 0;          ///< Lines in this part.
+    size_t bytes = 0;         ///< Size of this part.
+  };
+
+private:
+  String base_path;           ///< Directory for all files (empty for the current directory).
+  String base_filename;       ///< Name of the output, without path or extension.
+  String extension;           ///< Extension for each part file.
+  size_t max_bytes;           ///< Largest part to write (0 = no limit).
+  size_t max_rows;            ///< Most lines to put in a part (0 = no limit).
+  Scheduler & scheduler;
+  Scheduler::TaskGroup tasks;
+  size_t pending_count = 0;   ///< Parts handed to the scheduler since the last wait.
+
+  std::string text;           ///< Contents of the part being filled.
+  emp::vector<Part> parts;    ///< All parts so far; the last one is being filled.
+  std::atomic<size_t> changed_count = 0;
+
+  void _FinishPart() {
+    if (text.empty()) return;
+    if (pending_count == scheduler.GetThreadCount()) {
+      scheduler.Wait(tasks);
+      pending_count = 0;
+    }
+    ++pending_count;
+    const String filename = base_path + parts.back().filename;
+    scheduler.Run(tasks, [this, filename, part_text=std::move(text)](){
+      if (WriteIfChanged(filename, part_text)) ++changed_count;
+    });
+    text = std::string();
+  }
+
+public:
+  PartWriter(const String & base_path, const String & base_filename, const String & extension,
+             size_t max_bytes, size_t max_rows, Scheduler & scheduler)
+    : base_path(base_path), base_filename(base_filename), extension(extension)
+    , max_bytes(max_bytes), max_rows(max_rows), scheduler(scheduler) { }
+  PartWriter(const PartWriter &) = delete;
+
+  /// Name (relative to base_path) of the part file with the provided number, from 1.
+  String GetPartName(size_t part_num) const {
+    std::stringstream name;
+    name << base_filename << "-part" << std::setw(3) << std::setfill('0') << part_num << extension;
+    return name.str();
+  }
+  String GetIndexName() const { return base_filename + "-parts.txt"; }
+
+  const emp::vector<Part> & GetParts() const { return parts; }
+  size_t GetChangedCount() const { return changed_count; }
+
+  /// Add one record, starting a new part first if it would not fit in the current one.
+  void Add(std::string_view record) {
+    const size_t rows = static_cast<size_t>(std::count(record.begin(), record.end(), '\n'));
+    if (parts.size() && text.size()) {
+      const Part & part = parts.back();
+      if ((max_bytes && part.bytes + record.size() > max_bytes) ||
+          (max_rows && part.rows + rows > max_rows)) {
+        _FinishPart();
+      }
+    }
+    if (text.empty()) {
+      parts.push_back(Part{GetPartName(parts.size() + 1)});
+      emp::notify::TestWarning((max_bytes && record.size() > max_bytes) ||
+                               (max_rows && rows > max_rows),
+        "Question in '", parts.back().filename, "' is larger than the part limit on its own.");
+    }
+    Part & part = parts.back();
+    text.append(record);
+    ++part.records;
+    part.rows += rows;
+    part.bytes += record.size();
+  }
+
+  /// Write the last part and the index (a tsv file listing each part), wait for every part to
+  /// be written, and remove any parts left over from an earlier, longer output.  Returns the
+  /// number of files (parts and index) that changed.
+  size_t Finish() {
+    _FinishPart();
+    scheduler.Wait(tasks);
+
+    std::stringstream index;
+    index << "file\tquestions\trows\tbytes\n";
+    for (const Part & part : parts) {
+      index << part.filename << '\t' << part.records << '\t' << part.rows << '\t' << part.bytes
+            << '\n';
+    }
+    if (WriteIfChanged(base_path + GetIndexName(), index.str())) ++changed_count;
+
+    for (size_t part_num = parts.size() + 1; ; ++part_num) {
+      const String filename = base_path + GetPartName(part_num);
+      if (!std::filesystem::remove(filename.str())) break;
+      std::filesystem::remove(HashSidecarName(filename).str());
+    }
+    return changed_count;
+  }
+};
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "emp/base/notify.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+using emp::String;
+
+// A small HTTP server for previewing web output while editing questions.  It only listens on
+// localhost and runs on a single thread (connections are read without blocking, so a slow
+// client never holds up the others): pages are rendered into memory by the caller and
+// served from there (nothing is written to disk), with ETags so unchanged files are not sent
+// again.  Browsers subscribe to /events (server-sent events); between requests the server
+// calls a check function every few milliseconds, and whenever that reports a change every
+// subscribed page is told to reload.
+class PreviewServer {
+public:
+  struct Page {
+    std::string_view type;    ///< MIME type
+    std::string_view body;    ///< Contents (must stay valid until the next check).
+    std::string etag;         ///< Identifies this version of the contents ("" for none).
+  };
+
+  // Fill in the page for a path, returning false if there is no such page.
+  using page_fun_t = std::function<bool(const String & path, Page & page)>;
+  // Check for changes (reloading and re-rendering as needed); returns true if pages changed.
+  using check_fun_t = std::function<bool()>;
+
+  /// Script that makes a page reload whenever the server says it has changed.
+  static constexpr std::string_view reload_script =
+    "<script>new EventSource('/events').onmessage = () => location.reload();</script>\n";
+
+  /// MIME type to serve a file as, based on its extension.
+  static std::string_view GetMimeType(const String & path) {
+    const String ext = path.substr(std::min(path.rfind('.'), path.size()));
+    if (ext == ".html") return "text/html; charset=utf-8";
+    if (ext == ".js") return "text/javascript; charset=utf-8";
+    if (ext == ".css") return "text/css; charset=utf-8";
+    if (ext == ".png") return "image/png";
+    if (ext == ".jpg" || ext == ".jpeg") return "image/jpeg";
+    if (ext == ".gif") return "image/gif";
+    if (ext == ".svg") return "image/svg+xml";
+    if (ext == ".webp") return "image/webp";
+    if (ext == ".pdf") return "application/pdf";
+    return "application/octet-stream";
+  }
+
+private:
+  using clock_t = std::chrono::steady_clock;
+
+  struct PendingRequest {
+    int fd;
+    std::string request;          ///< Everything received so far.
+    clock_t::time_point deadline; ///< Give up on the connection if it is not complete by then.
+  };
+
+  static constexpr auto REQUEST_TIMEOUT = std::chrono::seconds(10);
+  static constexpr size_t MAX_REQUEST_SIZE = 65536;
+
+  int listen_fd = -1;
+  uint16_t port = 0;
+  emp::vector<int> event_fds;     ///< Connections waiting for reload events.
+  emp::vector<PendingRequest> pending;   ///< Connections still sending their request.
+
+  static bool _SendAll(int fd, std::string_view data) {
+    while (data.size()) {
+      const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+      if (sent < 0 && errno == EINTR) continue;
+      if (sent <= 0) return false;
+      data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+  }
+
+  // Value of a request header (names are case-insensitive), or "" if it is not present.
+  static std::string_view _GetHeader(std::string_view request, std::string_view name) {
+    size_t pos = request.find("\r\n");
+    while (pos != std::string_view::npos && pos + 2 < request.size()) {
+      const size_t line_start = pos + 2;
+      const size_t line_end = request.find("\r\n", line_start);
+      std::string_view line = request.substr(line_start, line_end - line_start);
+      const size_t colon = line.find(':');
+      if (colon == name.size() && strncasecmp(line.data(), name.data(), name.size()) == 0) {
+        line.remove_prefix(colon + 1);
+        while (line.size() && line.front() == ' ') line.remove_prefix(1);
+        return line;
+      }
+      pos = line_end;
+    }
+    return "";
+  }
+
+  static void _Respond(int fd, std::string_view status, std::string_view type,
+                       std::string_view body, const std::string & etag="") {
+    std::string header = "HTTP/1.1 ";
+    header.append(status).append("\r\nContent-Type: ").append(type)
+          .append("\r\nContent-Length: ").append(std::to_string(body.size()))
+          .append("\r\nCache-Control: no-cache\r\nConnection: close\r\n");
+    if (etag.size()) header.append("ETag: ").append(etag).append("\r\n");
+    header += "\r\n";
+    if (_SendAll(fd, header)) _SendAll(fd, body);
+  }
+
+  // Read whatever has arrived on a connection without waiting for more.  Returns true once the
+  // request is complete (or never will be, if the client closed the connection), false if more
+  // is still to come.
+  static bool _ReadAvailable(PendingRequest & pending_req) {
+    char buffer[4096];
+    while (true) {
+      const ssize_t count = recv(pending_req.fd, buffer, sizeof(buffer), 0);
+      if (count < 0 && errno == EINTR) continue;
+      if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+      if (count <= 0) return true;
+      pending_req.request.append(buffer, static_cast<size_t>(count));
+      if (pending_req.request.find("\r\n\r\n") != std::string::npos ||
+          pending_req.request.size() >= MAX_REQUEST_SIZE) return true;
+    }
+  }
+
+  void _HandleRequest(int fd, const std::string & request, const page_fun_t & page_fun) {
+    // Responses are sent in full; the client is on this machine and is waiting to read them.
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+    // Request line: METHOD PATH VERSION
+    const size_t method_end = request.find(' ');
+    const size_t path_end = request.find(' ', method_end + 1);
+    if (method_end == std::string::npos || path_end == std::string::npos) { close(fd); return; }
+    const std::string_view method = std::string_view(request).substr(0, method_end);
+    String path = request.substr(method_end + 1, path_end - method_end - 1);
+    if (const size_t query = path.find('?'); query != String::npos) path.resize(query);
+
+    if (method != "GET" && method != "HEAD") {
+      _Respond(fd, "405 Method Not Allowed", "text/plain", "Only GET is supported.\n");
+    }
+    else if (path == "/events") {
+      const std::string_view header = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                                      "Cache-Control: no-cache\r\n\r\n";
+      if (_SendAll(fd, header)) { event_fds.push_back(fd); return; }   // Keep open for events.
+    }
+    else {
+      Page page;
+      if (!page_fun(path, page)) {
+        _Respond(fd, "404 Not Found", "text/plain", "Not found.\n");
+      }
+      else if (page.etag.size() && _GetHeader(request, "If-None-Match") == page.etag) {
+        _Respond(fd, "304 Not Modified", page.type, "", page.etag);
+      }
+      else _Respond(fd, "200 OK", page.type, method == "HEAD" ? "" : page.body, page.etag);
+    }
+    close(fd);
+  }
+
+  void _SendReload() {
+    for (size_t i = event_fds.size(); i-- > 0;) {
+      if (_SendAll(event_fds[i], "data: reload\n\n")) continue;
+      close(event_fds[i]);
+      event_fds.erase(event_fds.begin() + static_cast<std::ptrdiff_t>(i));
+    }
+  }
+
+public:
+  PreviewServer(uint16_t port) : port(port) { }
+  PreviewServer(const PreviewServer &) = delete;
+  ~PreviewServer() {
+    for (int fd : event_fds) close(fd);
+    for (const PendingRequest & pending_req : pending) close(pending_req.fd);
+    if (listen_fd >= 0) close(listen_fd);
+  }
+
+  /// Start listening on localhost; returns false (after reporting the problem) on failure.
+  bool Start() {
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+      emp::notify::Error("Unable to create preview server socket: ", std::strerror(errno));
+      return false;
+    }
+    const int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        listen(listen_fd, 64) < 0) {
+      emp::notify::Error("Unable to listen on port ", port, ": ", std::strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  /// Serve pages until the process is stopped, calling check_fun at least every check_ms.
+  void Run(const page_fun_t & page_fun, const check_fun_t & check_fun, int check_ms=50) {
+    auto next_check = clock_t::now();
+    while (true) {
+      emp::vector<pollfd> fds{ pollfd{listen_fd, POLLIN, 0} };
+      for (int fd : event_fds) fds.push_back(pollfd{fd, POLLIN, 0});
+      for (const PendingRequest & pending_req : pending) {
+        fds.push_back(pollfd{pending_req.fd, POLLIN, 0});
+      }
+      const size_t event_count = event_fds.size();
+      const auto wait =
+        std::chrono::duration_cast<std::chrono::milliseconds>(next_check - clock_t::now());
+      poll(fds.data(), fds.size(), std::max(0, static_cast<int>(wait.count())));
+
+      // Event connections never send anything, so activity on one means it closed.
+      for (size_t i = event_count; i >= 1; --i) {
+        if (!fds[i].revents) continue;
+        close(fds[i].fd);
+        std::erase(event_fds, fds[i].fd);
+      }
+
+      // Continue reading partial requests that have more data; drop any that took too long.
+      const auto now = clock_t::now();
+      for (size_t i = pending.size(); i-- > 0;) {
+        PendingRequest & pending_req = pending[i];
+        const bool done = fds[1 + event_count + i].revents && _ReadAvailable(pending_req);
+        if (!done && now < pending_req.deadline) continue;
+        const PendingRequest finished = std::move(pending_req);
+        pending.erase(pending.begin() + static_cast<std::ptrdiff_t>(i));
+        if (done) _HandleRequest(finished.fd, finished.request, page_fun);
+        else close(finished.fd);
+      }
+
+      if (fds[0].revents & POLLIN) {
+        const int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd >= 0) {
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+          PendingRequest pending_req{fd, "", now + REQUEST_TIMEOUT};
+          if (_ReadAvailable(pending_req)) _HandleRequest(fd, pending_req.request, page_fun);
+          else pending.push_back(std::move(pending_req));
+        }
+      }
+      if (clock_t::now() >= next_check) {
+        if (check_fun()) _SendReload();
+        next_check = clock_t::now() + std::chrono::milliseconds(check_ms);
+      }
+    }
+  }
+};
@@ -1,12 +1,44 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string_view>
 
 #include "emp/base/vector.hpp"
 #include "emp/config/FlagManager.hpp"
 #include "emp/io/File.hpp"
 #include "emp/tools/String.hpp"
 
+#include "Diagnostics.hpp"
+#include "ExamSpec.hpp"
+#include "Generator.hpp"
+#include "LoadTest.hpp"
+#include "Manifest.hpp"
+#include "Metrics.hpp"
+#include "OutputFile.hpp"
+#include "PartWriter.hpp"
+#include "PreviewServer.hpp"
 #include "Question.hpp"
 #include "QuestionBank.hpp"
+#include "ShardCoordinator.hpp"
+#include "Scheduler.hpp"
+#include "SelectionCache.hpp"
+#include "TagIndex.hpp"
+#include "Template.hpp"
+
+// A question bank can be compiled in; see `make embedded` and Embedded.hpp.
+#ifdef QBL_EMBEDDED_BANK
+#include QBL_EMBEDDED_BANK
+#endif
 
 #define QBL_VERSION "0.0.1"
 
@@ -14,106 +46,80 @@ using emp::String;
 
 class QBL {
 private:
+  using Format = ExamSpec::Format;
+  using Order = ExamSpec::Order;
+
   QuestionBank qbank;
   emp::FlagManager flags;
-
-  enum class Format {
-    NONE=0,
-    QBL,
-    D2L,
-    GRADESCOPE,
-    LATEX,
-    WEB,
-    DEBUG
-  };
-
-  enum class Order {
-    DEFAULT = 0,
-    RANDOM,
-    ID,
-    ALPHABETIC
-  };
-
-  Format format = Format::NONE;       // No format set yet.
-  Order order = Order::DEFAULT;       // Don't reorder questions.
-  String base_path = "";              // Where are we placing these files?
-  String base_filename = "";          // Output filename; empty=no file
-  String extension = "";              // Provided extension to use for output file.
-  String log_filename = "";           // Where should we log questions to?
-  String title = "Multiple Choice Quiz"; // Title to use in any generated files.
-  emp::vector<String> include_tags;   // Include ALL questions with these tags.
-  emp::vector<String> exclude_tags;   // Exclude ALL questions with these tags (override includes)
-  emp::vector<String> require_tags;   // ONLY questions with these tags can be included.
-  emp::vector<String> sample_tags;    // Include at least one question with each of these tags.
+  emp::vector<String> command_line;   // Arguments QBL was run with (passed on to shard workers)
+  ExamSpec spec;                      // Exam to build from the command-line flags.
   emp::vector<String> question_files; // Full set of questions
-  emp::vector<String> avoid_files;    // Files with lists of questions IDs to avoid
-  size_t generate_count = 0;          // How many questions should be generated? (0 = use all)
-  emp::Random random;                 // Random number generator
-  bool compressed_format = false;     // Should GradeScope output be compressed?
-
-  // Helper functions
-  void _AddTags(emp::vector<String> & tags, const String & arg, size_t count=1) {
-    auto args = arg.Slice();
-    for (size_t i = 0; i < count; ++i) {
-      emp::Append(tags, args);
-    }
-  }
+  String batch_filename = "";         // File with one exam spec per line; empty=no batch
+  String batch_report = "";           // Where to record the results of each batch job
+  size_t shard_count = 0;             // Number of worker processes to split a batch across
+  String cache_filename = "";         // File to cache rendered questions in; empty=no cache
+  size_t cache_mb = 64;               // Maximum size of the render cache (in megabytes)
+  size_t reader_count = 0;            // Files to read ahead of the parser at once; 0=no read-ahead
+  size_t thread_count = 0;            // Threads for all parallel work; 0=one per hardware thread
+  String emit_cpp_filename = "";      // Write loaded questions as a C++ header; empty=don't
+  String regen_filename = "";         // Manifest of an exam to rebuild (`QBL regen`); empty=none
+  String replace_positions = "";      // Exam positions to swap out (`QBL replace`); empty=none
+  size_t variant_count = 0;           // Number of exam variants to stream out; 0=just one exam
+  String asset_dir = "";              // Directory for assets (relative to output); empty=default
+  bool hardlink_assets = false;       // Hardlink assets into the output rather than copy them
+  size_t loadgen_requests = 0;        // Requests to send in a load test (`QBL loadgen`); 0=none
+  size_t loadgen_clients = 1;         // Clients sending load test requests at once
+  size_t serve_port = 0;              // Port to serve a live web preview on; 0=don't serve
+  String metrics_filename = "";       // File to keep rewriting with metrics; empty=none
+  double load_ms = 0.0;               // Time taken to set up the question bank
+  emp::Ptr<RenderCache> render_cache = nullptr;
+  emp::Ptr<Scheduler> scheduler = nullptr;    // Shared by every phase (reading through output)
+  mutable SelectionCache selection_cache; // Candidate sets and responses reused across requests
+  TagIndex tag_index;                 // Questions with each tag, updated as the bank is edited
+  mutable Metrics metrics;            // Phase timings and other operational metrics
+  TemplateSet templates;              // Text around the questions in each output format
 
 public:
-  QBL(int argc, char * argv[]) : flags(argc, argv) {
-    flags.AddGroup("Basic Operation",
-      "These flags are the standard ones to use when running QBL.\n");
-    flags.AddOption('g', "--generate",[this](String arg){ SetGenerate(arg); },
-      "Randomly generate questions (number as arg).");
-//    flags.AddOption('I', "--interactive",     [this](){},
-//      "Start QBL in interactive mode for more dynamic exam generation.");
-    flags.AddOption('o', "--output",  [this](String arg){ SetOutput(arg); },
-      "Set output file name [arg].");
-    flags.AddOption('S', "--seed", [this](String arg){ SetRandomSeed(arg); },
-      "Set the random number seed with the following argument [arg]");
-    flags.AddOption('t', "--title", [this](String arg){ SetTitle(arg); },
-      "Specify the quiz/exam title to use in the generated file.");
-
-    flags.AddGroup("Output Format",
-      "These flags specify the output format to use.  If none are provided, the\n"
-      "extension on the output filename is used, or else QBL format is the default.\n");
-    flags.AddOption('d', "--d2l",     [this](){ SetFormat(Format::D2L); },
-      "Set output to be D2L / Brightspace csv quiz upload format.");
-    flags.AddOption('G', "--gradescope",     [this](){ SetFormat(Format::GRADESCOPE); },
-      "Set output to be in Latex format suitable for using with GradeScope.");
-    flags.AddOption('l', "--latex",   [this](){ SetFormat(Format::LATEX); },
-      "Set output to be Latex format.");
-    flags.AddOption('q', "--qbl",     [this](){ SetFormat(Format::QBL); },
-      "Set output to be QBL format.");
-    flags.AddOption('w', "--web",     [this](){ SetFormat(Format::WEB); },
-      "Set output to HTML/CSS/JS format.");
-    flags.AddOption('O', "--order",   [this](String arg){ SetOrder(arg); },
-      "Set the question order based on [arg] (\"random\", \"id\", or \"alpha\")");
-    flags.AddOption('c', "--compressed",   [this](){ compressed_format = true; },
-      "Make questions take less space (only works for GradeScope output).");
-
-    flags.AddGroup("Question Specification",
-      "These options provide addition constraints as QBL decides which questions\n"
-      "should or should not be used in the output.\n");
-    flags.AddOption('i', "--include", [this](String arg){ _AddTags(include_tags, arg); },
-      "Include ALL questions with the following tag(s), not otherwise excluded.");
-    flags.AddOption('r', "--require", [this](String arg){ _AddTags(require_tags, arg); },
-      "Only questions with the following tag(s) can be included.");
-    flags.AddOption('s', "--sample",
-      [this](String tag_arg, String count_arg){ _AddTags(sample_tags, tag_arg, count_arg.As<size_t>()); },
-      "Specify tag(s) and the number of times they should be included.");
-    flags.AddOption('x', "--exclude", [this](String arg){ _AddTags(exclude_tags, arg); },
-      "Exclude all questions with following tag(s).");
-    flags.AddOption('L', "--log", [this](String arg){ log_filename = arg; },
-      "Log the IDs of the questions chosen to the file [arg].");
-    flags.AddOption('a', "--avoid", [this](String arg){ avoid_files.push_back(arg); },
-      "Provide a filename ([arg]) to avoid questions from; can previously be generated as log.");
-    
+  QBL(int argc, char * argv[]) : flags(argc, argv), command_line(argv, argv + argc) {
+    spec.AddFlags(flags);
+
+    flags.SetGroup("Basic Operation");
+    flags.AddOption('b', "--batch", [this](String arg){ batch_filename = arg; },
+      "Build one exam for each line of flags in file [arg], loading questions only once.");
+    flags.AddOption('B', "--batch-report", [this](String arg){ batch_report = arg; },
+      "Record the status, time, and output of each batch job to file [arg].");
+    flags.AddOption('N', "--variants", [this](String arg){ variant_count = arg.As<size_t>(); },
+      "Build [arg] exam variants (using consecutive seeds), each in its own numbered file.");
+    flags.AddOption('P', "--shards", [this](String arg){ shard_count = arg.As<size_t>(); },
+      "Split the batch across [arg] worker QBL processes, merging their reports.");
+
+    flags.AddOption('R', "--readers", [this](String arg){ reader_count = arg.As<size_t>(); },
+      "Read up to [arg] question files at once ahead of parsing (default 0 = off).");
+    flags.AddOption('j', "--jobs", [this](String arg){ thread_count = arg.As<size_t>(); },
+      "Use [arg] threads for loading, generating, and rendering (default: one per core).");
+    flags.AddOption('W', "--serve", [this](String arg){ serve_port = arg.As<size_t>(); },
+      "Serve a live preview of the web output at http://localhost:[arg]/ (reloads on edits).");
+    flags.AddOption('m', "--metrics", [this](String arg){ metrics_filename = arg; },
+      "Keep file [arg] updated with Prometheus metrics (also at /metrics with --serve).");
+    flags.AddOption('E', "--emit-cpp", [this](String arg){ emit_cpp_filename = arg; },
+      "Write the loaded questions to C++ header [arg], to compile into QBL (see `make embedded`).");
+
+    flags.SetGroup("Output Format");
+    flags.AddOption('C', "--cache", [this](String arg){ cache_filename = arg; },
+      "Reuse rendered questions from earlier runs, stored in cache file [arg].");
+    flags.AddOption('Z', "--cache-size", [this](String arg){ cache_mb = arg.As<size_t>(); },
+      "Limit the render cache file to [arg] megabytes (default 64).");
+    flags.AddOption('A', "--assets", [this](String arg){ asset_dir = arg; },
+      "Place question images and attachments in directory [arg] next to the output (default assets).");
+    flags.AddOption('H', "--hardlink-assets", [this](){ hardlink_assets = true; },
+      "Hardlink assets into the output directory instead of copying them.");
+    flags.AddOption('T', "--template", [this](String arg){ if (!templates.Load(arg)) exit(1); },
+      "Replace an output template using [arg] as name=file (e.g. latex_header=head.tex).");
 
     flags.SetGroup("none");
  //    flags.AddOption('c', "--command",     [this](){},
  //      "Run a single interactive command; e.g. `var=12`.");
-    flags.AddOption('D', "--debug",   [this](){ SetFormat(Format::DEBUG); },
+    flags.AddOption('D', "--debug",   [this](){ spec.SetFormat(Format::DEBUG); },
       "Print extra debug information.");
     flags.AddOption('h', "--help",    [this](){ PrintHelp(); },
       "Provide usage information for QBL (this message)");
@@ -123,72 +129,64 @@ public:
 
     flags.Process();
     question_files = flags.GetExtras();
-  }
 
-  void SetTitle(const String & in) { title = in; }
-
-  void SetFormat(Format f) {
-    emp::notify::TestWarning(format != Format::NONE,
-      "Setting format to '", GetFormatName(f),
-      "', but was already set to ", GetFormatName(format), ".");
-    format = f;
-  }
-
-  void SetOutput(String _filename, bool update_ok=false) {
-    if (base_filename.size() && !update_ok) {
-      emp::notify::Error("Only one output mode allowed at a time.");
-      exit(1);
+    // `QBL regen [manifest] {question files}` rebuilds an exam recorded with --manifest.
+    if (argc > 1 && String(argv[1]) == "regen") {
+      if (question_files.size() < 2) {
+        emp::notify::Error("Usage: ", argv[0], " regen [manifest] {-o [output]} {question files}");
+        exit(1);
+      }
+      regen_filename = question_files[1];
+      question_files.erase(question_files.begin(), question_files.begin() + 2);
     }
-    std::cout << "Directing output to file '" << _filename << "'." << std::endl;
-    size_t slash_pos = _filename.RFind('/');
-    if (slash_pos != emp::String::npos) {
-      if (slash_pos+1 == _filename.size()) {
-        emp::notify::Error("Must provide a filename (not directory) for output.");
+
+    // `QBL replace [manifest] [positions] {question files}` swaps vetoed questions out of one.
+    else if (argc > 1 && String(argv[1]) == "replace") {
+      if (question_files.size() < 3) {
+        emp::notify::Error("Usage: ", argv[0],
+                           " replace [manifest] [positions, e.g. 3,7] {-o [output]} {question files}");
         exit(1);
       }
-      base_path = _filename.PopFixed(slash_pos+1);
+      regen_filename = question_files[1];
+      replace_positions = question_files[2];
+      question_files.erase(question_files.begin(), question_files.begin() + 3);
     }
-    size_t dot_pos = _filename.RFind('.');
-    base_filename = _filename.substr(0, dot_pos);
-    extension = _filename.View(dot_pos);
-    // If we don't have a format yet, set it based on the filename.
-    if (format == Format::NONE) {
-      if (extension == ".csv" || extension == ".d2l") format = Format::D2L;
-      if (extension == ".gscope") format = Format::GRADESCOPE;
-      else if (extension == ".html" || extension == ".htm") format = Format::WEB;
-      else if (extension == ".tex") format = Format::LATEX;
-      else if (extension == ".qbl") format = Format::QBL;
+
+    // `QBL loadgen [requests] [clients] {question files}` measures QBL under a request load.
+    else if (argc > 1 && String(argv[1]) == "loadgen") {
+      if (question_files.size() < 3) {
+        emp::notify::Error("Usage: ", argv[0],
+                           " loadgen [requests] [clients] {-b [request mix]} {question files}");
+        exit(1);
+      }
+      loadgen_requests = question_files[1].As<size_t>();
+      loadgen_clients = question_files[2].As<size_t>();
+      question_files.erase(question_files.begin(), question_files.begin() + 3);
     }
-  }
 
-  void SetGenerate(String _count) {
-    if (generate_count != 0) {
-      emp::notify::Error("Can only set one value for number of questions to generate.");
+    if (asset_dir.size()) qbank.GetAssetStore().SetDir(asset_dir);
+    if (cache_filename.size()) {
+      render_cache = emp::NewPtr<RenderCache>(cache_filename, cache_mb * 1024 * 1024);
     }
-    generate_count = _count.As<size_t>();
-    // If order hasn't been manually set, change it to random.
-    if (order == Order::DEFAULT) order = Order::RANDOM;
-  }
-  
-  void SetRandomSeed(String _seed) {
-    int random_seed = _seed.As<int>();
-    std::cout << "Using random seed: " << random_seed << std::endl;
-    random.ResetSeed(random_seed);
+    scheduler = emp::NewPtr<Scheduler>(thread_count);
+    qbank.SetScheduler(scheduler);
+    qbank.SetSelectionCache(&selection_cache);
+    qbank.SetTagIndex(&tag_index);
+    metrics.SetGaugeFun([this](std::ostream & os){ WriteMetrics(os); });
   }
 
-  void SetOrder(String _order) {
-    if (_order == "random") { order = Order::RANDOM; }
-    else if (_order == "id") { order = Order::ID; }
-    else if (_order == "alpha") { order = Order::ALPHABETIC; }
-    // @CAO - Other options are layout filenames
+  ~QBL() {
+    metrics.Stop();                            // Its last write reads the caches and scheduler.
+    if (render_cache) render_cache.Delete();   // Deleting the render cache saves it.
+    scheduler.Delete();
   }
 
-  void UpdateOrder() {
+  void UpdateOrder(QuestionBank & exam, Order order, emp::Random & random) const {
     switch (order) {
     case Order::DEFAULT:    break; // No changes needed
-    case Order::RANDOM:     qbank.Randomize(random); break;
-    case Order::ID:         qbank.SortID();          break;
-    case Order::ALPHABETIC: qbank.SortAlpha();       break;
+    case Order::RANDOM:     exam.Randomize(random); break;
+    case Order::ID:         exam.SortID();          break;
+    case Order::ALPHABETIC: exam.SortAlpha();       break;
     }
   }
 
@@ -203,240 +201,1133 @@ public:
     exit(0);
   }
 
-  String GetFormatName(Format id) const {
-    switch (id) {
-    case Format::NONE: return "NONE";
-    case Format::D2L: return "D2L";
-    case Format::GRADESCOPE: return "GRADESCOPE";
-    case Format::LATEX: return "LATEX";
-    case Format::QBL: return "QBL";
-    case Format::WEB: return "WEB";
-    case Format::DEBUG: return "Debug";
+  void LoadFiles() {
+    const auto start_time = std::chrono::steady_clock::now();
+#ifdef QBL_EMBEDDED_BANK
+    qbank.LoadEmbedded(qbl_embedded_bank);   // Compiled-in questions come first.
+#endif
+    if (reader_count == 0) {
+      for (auto filename : question_files) qbank.LoadFile(filename);
+    } else {
+      // Start reading every file (and whatever they include) before parsing the first one.
+      FileReader reader(*scheduler, reader_count);
+      for (auto filename : question_files) {
+        reader.Prefetch(CanonicalPath(std::filesystem::path(filename.str())));
+      }
+      qbank.SetFileReader(&reader);
+      for (auto filename : question_files) qbank.LoadFile(filename);
+      qbank.SetFileReader(nullptr);
+    }
+    const auto load_time = std::chrono::steady_clock::now() - start_time;
+    load_ms = std::chrono::duration<double, std::milli>(load_time).count();
+    metrics.Observe(Metrics::Phase::LOAD, load_ms);
+  }
+
+  void Validate() {
+    qbank.Validate();
+  }
+
+  /// Fill an (empty) exam with the questions to use, based on the provided spec.  Returns the
+  /// random seed used (which was chosen from the time if the spec did not provide one).
+  int BuildExam(const ExamSpec & exam_spec, QuestionBank & exam) const {
+    const auto start_time = std::chrono::steady_clock::now();
+    emp::Random random(exam_spec.random_seed);
+    if (exam_spec.generate_count) {
+      const bool keep_selection = exam_spec.format == Format::DEBUG;   // Shown in debug output.
+      auto ids = qbank.Select(exam_spec.generate_count, random, exam_spec.include_tags,
+                              exam_spec.exclude_tags, exam_spec.require_tags,
+                              exam_spec.sample_tags, exam_spec.avoid_files,
+                              keep_selection ? &exam.GetSelection() : nullptr);
+      exam.AddCopies(qbank, ids);
+      exam.GenerateVariants(random);
+    }
+    else exam.AddCopies(qbank);
+    UpdateOrder(exam, exam_spec.order, random);
+    exam.SetRenderCache(render_cache);
+    exam.SetScheduler(scheduler);
+    exam.SetTemplates(&templates, exam_spec.title, exam_spec.base_filename);
+    const std::chrono::duration<double, std::milli> select_ms =
+      std::chrono::steady_clock::now() - start_time;
+    metrics.Observe(Metrics::Phase::SELECT, select_ms.count());
+    return random.GetSeed();
+  }
+
+  /// Build a single exam and print it to the output specified (reporting what was written to
+  /// msg_out).
+  void RunExam(const ExamSpec & exam_spec, std::ostream & msg_out=std::cout) const {
+    using clock_t = std::chrono::steady_clock;
+    const auto start_time = clock_t::now();
+    QuestionBank exam;
+    const int seed = BuildExam(exam_spec, exam);
+    const auto select_time = clock_t::now();
+    Print(exam, exam_spec, msg_out);
+    const std::chrono::duration<double, std::milli> render_ms = clock_t::now() - select_time;
+    const std::chrono::duration<double, std::milli> request_ms = clock_t::now() - start_time;
+    metrics.Observe(Metrics::Phase::RENDER, render_ms.count());
+    metrics.Observe(Metrics::Phase::REQUEST, request_ms.count());
+    if (exam_spec.manifest_filename.size()) WriteManifest(exam, exam_spec, seed);
+  }
+
+  /// Record everything needed to rebuild this exam exactly from the current question bank.
+  void WriteManifest(const QuestionBank & exam, const ExamSpec & exam_spec, int seed) const {
+    ExamManifest manifest;
+    manifest.qbl_version = QBL_VERSION;
+    manifest.render_version = QBL_RENDER_VERSION;
+    manifest.seed = seed;
+    manifest.format = ExamSpec::GetFormatName(exam_spec.format);
+    manifest.title = exam_spec.title;
+    if (exam_spec.HasOutputFile()) manifest.output = exam_spec.GetOutputFilename();
+    manifest.compressed = exam_spec.compressed_format;
+    manifest.fragments = exam_spec.split_fragments;
+    manifest.bank_files = question_files;
+    manifest.bank_hash = qbank.GetSnapshotHash();
+    manifest.include_tags = exam_spec.include_tags;
+    manifest.exclude_tags = exam_spec.exclude_tags;
+    manifest.require_tags = exam_spec.require_tags;
+    manifest.sample_tags = exam_spec.sample_tags;
+    manifest.avoid_files = exam_spec.avoid_files;
+    manifest.asset_dir = qbank.GetAssetStore().GetDir();
+    for (const auto & [name, loaded] : templates.GetOverrides()) {
+      manifest.templates.push_back({name, loaded.hash, loaded.filename});
+    }
+    for (size_t pos = 0; pos < exam.GetSize(); ++pos) {
+      const Question & q = exam.GetQuestionAt(pos);
+      const Question & original = qbank.GetQuestionAt(qbank.FindID(q.GetID()));
+      manifest.questions.push_back({q.GetID(), original.GetIdentityHash(), q.GetVariant()});
+    }
+    std::stringstream ss;
+    manifest.Write(ss);
+    WriteIfChanged(exam_spec.manifest_filename, ss.str());
+  }
+
+  /// Lazily build and render exams from the loaded bank: each one is produced only when the
+  /// caller asks for the next, using the next random seed after the spec's (count=0 for no
+  /// limit).  Each exam is rendered into the same buffer, so its text is only valid until the
+  /// next is requested.  Formats must be printable to a stream (not web or fragments).
+  Generator<std::string_view> StreamExams(ExamSpec exam_spec, size_t count=0) const {
+    RenderBuffer buffer;
+    const uint64_t base_seed = static_cast<uint64_t>(emp::Random(exam_spec.random_seed).GetSeed());
+    for (size_t variant_id = 0; count == 0 || variant_id < count; ++variant_id) {
+      exam_spec.random_seed = 1 + static_cast<int>((base_seed + variant_id) % (INT_MAX - 1));
+      QuestionBank exam;
+      BuildExam(exam_spec, exam);
+      ExportAssets(exam.GetAssetPaths(), exam_spec);
+      buffer.Clear();
+      Print(exam, exam_spec, exam_spec.format, buffer);
+      co_yield buffer.View();
+    }
+  }
+
+  /// Write each exam variant to its own file (name-1.ext, name-2.ext, ...), or all of them to
+  /// standard output if there is no output file.
+  void RunVariants() const {
+    if (spec.format == Format::WEB || spec.split_fragments || spec.IsSplitParts()) {
+      emp::notify::Error("Exam variants cannot use web output, fragments, or part files.");
+      return;
+    }
+    if (spec.log_filename.size() || spec.manifest_filename.size()) {
+      emp::notify::Error("Exam variants cannot be logged (-L) or given a manifest (-M).");
+      return;
+    }
+    size_t variant_id = 0, changed_count = 0;
+    for (std::string_view text : StreamExams(spec, variant_count)) {
+      ++variant_id;
+      if (!spec.HasOutputFile()) { std::cout << text; continue; }
+      const String filename =
+        emp::MakeString(spec.base_path, spec.base_filename, '-', variant_id, spec.extension);
+      if (WriteIfChanged(filename, text)) ++changed_count;
+    }
+    if (spec.HasOutputFile()) {
+      std::cout << "Updated " << changed_count << " of " << variant_id << " exam variants for '"
+                << spec.GetOutputFilename() << "'." << std::endl;
+    }
+  }
+
+  bool IsRegen() const { return regen_filename.size() && replace_positions.empty(); }
+  bool IsReplace() const { return replace_positions.size(); }
+
+  /// Use the asset directory and output templates recorded in a manifest, so the exam is
+  /// rebuilt with the same text around it.  Templates replaced when the exam was made are
+  /// loaded again from the same files; any given now with -T (or -A) must match what was used.
+  /// Returns false (after reporting the problem) if they cannot be matched.
+  bool ApplyManifestLayout(const ExamManifest & manifest) {
+    if (manifest.asset_dir.size()) {
+      if (asset_dir.size() && asset_dir != manifest.asset_dir) {
+        emp::notify::Error("Manifest '", regen_filename, "' placed assets in '",
+                           manifest.asset_dir, "', not '", asset_dir,
+                           "'; unable to rebuild the exam.");
+        return false;
+      }
+      qbank.GetAssetStore().SetDir(manifest.asset_dir);
+    }
+
+    std::set<String> recorded;
+    for (const ExamManifest::TemplateEntry & entry : manifest.templates) {
+      recorded.insert(entry.name);
+      if (!templates.GetOverrides().contains(entry.name) &&
+          !templates.Load(entry.name + "=" + entry.filename)) {
+        emp::notify::Error("Template '", entry.name, "' is needed to rebuild the exam in '",
+                           regen_filename, "'; provide it with -T.");
+        return false;
+      }
+      if (templates.GetOverrides().at(entry.name).hash != entry.hash) {
+        emp::notify::Error("Template '", entry.name, "' has changed since manifest '",
+                           regen_filename, "' was written; unable to rebuild the exam.");
+        return false;
+      }
+    }
+    for (const auto & [name, loaded] : templates.GetOverrides()) {
+      if (recorded.contains(name)) continue;
+      emp::notify::Error("Manifest '", regen_filename, "' was written with the built-in '", name,
+                         "' template, not '", loaded.filename, "'; unable to rebuild the exam.");
+      return false;
+    }
+    return true;
+  }
+
+  /// Load the question bank for an exam's manifest and rebuild the exam from it.  Question
+  /// files come from the manifest unless others are provided; each question used must be
+  /// unchanged (and in a file of the same name), but the rest of the bank may differ.  The
+  /// bank position of each exam question is placed in `bank_ids`.  Returns false on failure.
+  bool LoadManifestExam(ExamManifest & manifest, ExamSpec & regen_spec, QuestionBank & exam,
+                        emp::vector<size_t> & bank_ids) {
+    if (!manifest.Load(regen_filename)) return false;
+    if (!ApplyManifestLayout(manifest)) return false;
+    if (question_files.empty()) question_files = manifest.bank_files;
+    LoadFiles();
+    Validate();
+
+    emp::notify::TestWarning(qbank.GetSnapshotHash() != manifest.bank_hash,
+      "Question bank differs from the snapshot in manifest '", regen_filename,
+      "'; using the questions listed, which are unchanged.");
+    emp::notify::TestWarning(manifest.render_version != QBL_RENDER_VERSION,
+      "Manifest '", regen_filename, "' was rendered with version ", manifest.render_version,
+      " (now ", QBL_RENDER_VERSION, "); output may differ from the original.");
+
+    // Output settings come from the manifest, though the output file may be redirected.
+    regen_spec.format = ExamSpec::GetFormatID(manifest.format);
+    regen_spec.title = manifest.title;
+    regen_spec.compressed_format = manifest.compressed;
+    regen_spec.split_fragments = manifest.fragments;
+    regen_spec.random_seed = manifest.seed;
+    regen_spec.include_tags = manifest.include_tags;
+    regen_spec.exclude_tags = manifest.exclude_tags;
+    regen_spec.require_tags = manifest.require_tags;
+    regen_spec.sample_tags = manifest.sample_tags;
+    regen_spec.avoid_files = manifest.avoid_files;
+    if (spec.HasOutputFile()) regen_spec.SetOutput(spec.GetOutputFilename());
+    else if (manifest.output.size()) regen_spec.SetOutput(manifest.output);
+
+    emp::vector<uint64_t> identities;
+    for (const ExamManifest::Entry & entry : manifest.questions) identities.push_back(entry.hash);
+    bank_ids = qbank.FindIdentities(identities);
+    for (size_t exam_pos = 0; exam_pos < bank_ids.size(); ++exam_pos) {
+      const ExamManifest::Entry & entry = manifest.questions[exam_pos];
+      const size_t pos = bank_ids[exam_pos];
+      if (pos == qbank.GetSize()) {
+        emp::notify::Error("Question ", entry.id, " from manifest '", regen_filename,
+                           "' is missing or has changed; unable to rebuild the exam.");
+        return false;
+      }
+      exam.AddCopies(qbank, {pos});
+      exam.SetID(exam.GetSize() - 1, entry.id);    // Keep the ID (and its seed) from the exam.
+      if (!exam.ApplyVariant(exam.GetSize() - 1, entry.variant)) {
+        emp::notify::Error("Question ", entry.id, " cannot use variant '", entry.variant,
+                           "' from manifest '", regen_filename, "'.");
+        return false;
+      }
+    }
+    exam.SetRenderCache(render_cache);
+    exam.SetScheduler(scheduler);
+    exam.SetTemplates(&templates, regen_spec.title, regen_spec.base_filename);
+    return true;
+  }
+
+  /// Rebuild an exam from its manifest.  Returns the exit code for QBL.
+  int RunRegen() {
+    ExamManifest manifest;
+    ExamSpec regen_spec;
+    QuestionBank exam;
+    emp::vector<size_t> bank_ids;
+    if (!LoadManifestExam(manifest, regen_spec, exam, bank_ids)) return 1;
+    Print(exam, regen_spec);
+    return 0;
+  }
+
+  /// Replace vetoed questions (by position, from 1) in an exam from its manifest, keeping the
+  /// rest of the exam exactly as it was.  Replacements follow the exam's original constraints
+  /// (see QuestionBank::SelectReplacement), and the manifest is updated to match (or written
+  /// to -M instead).  With fragment output, only the replaced fragments are rendered and
+  /// rewritten.  Returns the exit code for QBL.
+  int RunReplace() {
+    ExamManifest manifest;
+    ExamSpec regen_spec;
+    QuestionBank exam;
+    emp::vector<size_t> exam_ids, rejected;
+    if (!LoadManifestExam(manifest, regen_spec, exam, exam_ids)) return 1;
+
+    emp::vector<size_t> positions;
+    for (const String & pos_str : replace_positions.Slice(",")) {
+      const size_t pos = pos_str.As<size_t>();
+      if (pos == 0 || pos > exam.GetSize()) {
+        emp::notify::Error("Cannot replace question ", pos_str, "; exam has questions 1 to ",
+                           exam.GetSize(), ".");
+        return 1;
+      }
+      positions.push_back(pos - 1);
+    }
+
+    // Questions vetoed by earlier replacements must not come back (if still in the bank).
+    emp::vector<uint64_t> rejected_identities;
+    for (const ExamManifest::Entry & entry : manifest.rejected) {
+      rejected_identities.push_back(entry.hash);
+    }
+    for (size_t bank_pos : qbank.FindIdentities(rejected_identities)) {
+      if (bank_pos < qbank.GetSize()) rejected.push_back(bank_pos);
+    }
+
+    for (size_t pos : positions) {
+      ExamManifest::Entry & entry = manifest.questions[pos];
+      // Seed from the exam and the vetoed question, so a replacement can be repeated.
+      const uint64_t seed = HashValues(manifest.seed, entry.id);
+      emp::Random random(static_cast<int>(1 + seed % (INT_MAX - 1)));
+      const size_t pick = qbank.SelectReplacement(exam_ids, pos, rejected, random,
+        regen_spec.exclude_tags, regen_spec.require_tags, regen_spec.sample_tags,
+        regen_spec.avoid_files);
+      if (pick == qbank.GetSize()) {
+        emp::notify::Error("No question is available to replace question ", pos+1, " (ID ",
+                           entry.id, ") under the exam's constraints.");
+        return 1;
+      }
+      rejected.push_back(exam_ids[pos]);
+      manifest.rejected.push_back({entry.id, entry.hash, ""});
+      exam_ids[pos] = pick;
+      exam.ReplaceQuestion(pos, qbank, pick, random);
+
+      const Question & q = exam.GetQuestionAt(pos);
+      std::cout << "Replaced question " << (pos+1) << " (ID " << entry.id << ") with ID "
+                << q.GetID() << "." << std::endl;
+      entry = {q.GetID(), qbank.GetQuestionAt(pick).GetIdentityHash(), q.GetVariant()};
+    }
+
+    // Fragment \input lines don't change, so only the replaced fragments need rewriting.
+    const bool is_latex = regen_spec.format == Format::LATEX || regen_spec.format == Format::GRADESCOPE;
+    if (is_latex && regen_spec.split_fragments && regen_spec.HasOutputFile() &&
+        std::filesystem::exists(regen_spec.GetOutputFilename().str())) {
+      for (size_t pos : positions) {
+        std::stringstream ss;
+        PrintFragment(exam, regen_spec, pos, ss);
+        WriteIfChanged(regen_spec.base_path + regen_spec.GetFragmentName(pos+1) + ".tex", ss.str());
+      }
+      std::cout << "Updated " << positions.size() << " question fragments for '"
+                << regen_spec.GetOutputFilename() << "'." << std::endl;
+    }
+    else Print(exam, regen_spec);
+
+    std::stringstream ss;
+    manifest.Write(ss);
+    WriteIfChanged(spec.manifest_filename.size() ? spec.manifest_filename : regen_filename, ss.str());
+    return 0;
+  }
+
+  /// Collect the jobs from the batch file (one set of flags per line, skipping comments).
+  emp::vector<String> LoadBatchLines() const {
+    emp::notify::TestError(!std::filesystem::exists(batch_filename.str()),
+      "Unable to open batch file '", batch_filename, "'.");
+    emp::File batch_file(batch_filename);
+    batch_file.RemoveIfBegins("%");  // Remove all comment lines.
+
+    emp::vector<String> lines;
+    for (const String & line : batch_file) {
+      if (!line.OnlyWhitespace()) lines.push_back(line);
+    }
+    return lines;
+  }
+
+  /// Parse the spec on each batch job line, setting job_status to why each job cannot run
+  /// ("ok" if it can).  Every job in a batch may run at once (even across shards), so the
+  /// whole list is checked for jobs writing the same file.
+  emp::vector<ExamSpec> ParseBatchJobs(const emp::vector<String> & job_lines,
+                                       emp::vector<String> & job_status) const {
+    emp::vector<ExamSpec> jobs(job_lines.size());
+    job_status.assign(jobs.size(), "ok");
+    std::map<String, size_t> file_jobs;   // Job writing each output file, by canonical path.
+    for (size_t job_id = 0; job_id < jobs.size(); ++job_id) {
+      auto extras = jobs[job_id].ProcessArgs(ExamSpec::SplitArgs(job_lines[job_id]));
+      emp::notify::TestWarning(extras.size(), "Batch job ", job_id+1,
+        " has extra arguments ", emp::MakeLiteral(extras), "; question files must be "
+        "provided on the command line.");
+      if (!jobs[job_id].HasOutputFile()) {
+        emp::notify::Error("Batch job ", job_id+1, " must specify an output file with -o.");
+        job_status[job_id] = "no-output";
+        continue;
+      }
+      // Jobs run at the same time, so two writing the same file would clobber each other.
+      for (const String & filename : { jobs[job_id].GetOutputFilename(),
+                                       jobs[job_id].manifest_filename }) {
+        if (filename.empty()) continue;
+        const auto [it, is_new] = file_jobs.emplace(CanonicalPath(filename.str()), job_id);
+        if (is_new || job_status[job_id] != "ok") continue;
+        emp::notify::Error("Batch jobs ", it->second+1, " and ", job_id+1, " both write to '",
+                           filename, "'; skipping job ", job_id+1, ".");
+        job_status[job_id] = "duplicate-output";
+      }
+    }
+    return jobs;
+  }
+
+  /// Build an exam for each line of the batch file; the question bank is shared by all of
+  /// them (it is not modified during generation), so exams are built in parallel.
+  void RunBatch() const {
+    emp::vector<String> job_status;
+    const emp::vector<ExamSpec> jobs = ParseBatchJobs(LoadBatchLines(), job_status);
+
+    // Each job's messages are held until all have finished, then printed in job order.
+    using clock_t = std::chrono::steady_clock;
+    emp::vector<double> job_ms(jobs.size(), 0.0);
+    emp::vector<std::stringstream> job_messages(jobs.size());
+    emp::vector<DiagnosticLog> job_logs(jobs.size());
+    const auto start_time = clock_t::now();
+    scheduler->ParallelFor(0, jobs.size(), [&](size_t job_id){
+      if (job_status[job_id] != "ok") return;
+      const auto job_start = clock_t::now();
+      job_logs[job_id].Capture([&](){ RunExam(jobs[job_id], job_messages[job_id]); });
+      const std::chrono::duration<double, std::milli> duration = clock_t::now() - job_start;
+      job_ms[job_id] = duration.count();
+    });
+    const std::chrono::duration<double, std::milli> total_ms = clock_t::now() - start_time;
+    for (size_t job_id = 0; job_id < jobs.size(); ++job_id) {
+      job_logs[job_id].Report();
+      std::cout << job_messages[job_id].str();
+    }
+
+    std::cout << "Batch timing (" << jobs.size() << " jobs on " << scheduler->GetThreadCount()
+              << " threads):\n";
+    for (size_t job_id = 0; job_id < jobs.size(); ++job_id) {
+      std::cout << "  job " << (job_id+1) << " (" << jobs[job_id].GetOutputFilename() << "): "
+                << job_ms[job_id] << " ms\n";
+    }
+    std::cout << "  total: " << total_ms.count() << " ms" << std::endl;
+
+    // Report is tab separated: job number, status, time in ms, and output file.
+    if (batch_report.size()) {
+      std::ofstream report(batch_report);
+      for (size_t job_id = 0; job_id < jobs.size(); ++job_id) {
+        report << (job_id+1) << '\t' << job_status[job_id] << '\t' << job_ms[job_id] << '\t'
+               << jobs[job_id].GetOutputFilename() << '\n';
+      }
+    }
+  }
+
+  bool IsLoadTest() const { return loadgen_requests; }
+
+  /// Build a varied mix of exam requests from the bank's own tags, to stand in for real
+  /// traffic: different question counts, tag constraints, output formats, and avoid lists
+  /// (written to the existing directory avoid_dir).  The mix depends only on the bank and -S.
+  emp::vector<ExamSpec> MakeLoadMix(size_t mix_size, const String & avoid_dir) const {
+    emp::Random random(spec.random_seed == -1 ? 1 : spec.random_seed);
+    const emp::vector<String> tags = qbank.GetAllTags();
+    auto random_tag = [&](){ return tags[random.GetUInt(tags.size())]; };
+
+    // A few lists of questions to avoid, as if recorded from earlier exams.
+    emp::vector<String> avoid_files;
+    for (size_t i = 0; i < 4; ++i) {
+      avoid_files.push_back(emp::MakeString(avoid_dir, "/avoid", i, ".txt"));
+      std::ofstream file(avoid_files.back().str());
+      for (size_t j = 0; j < qbank.GetSize() / 10; ++j) {
+        file << qbank.GetQuestionAt(random.GetUInt(qbank.GetSize())).GetID() << '\n';
+      }
+    }
+
+    const Format formats[] = { Format::QBL, Format::D2L, Format::LATEX, Format::GRADESCOPE,
+                               Format::WEB };
+    emp::vector<ExamSpec> mix(mix_size);
+    for (ExamSpec & request : mix) {
+      request.format = formats[random.GetUInt(std::size(formats))];
+      request.title = spec.title;
+      request.order = Order::RANDOM;
+      if (tags.size() && random.P(0.4)) request.require_tags.push_back(random_tag());
+      if (tags.size() && random.P(0.3)) {
+        const String tag = random_tag();
+        if (!emp::Has(request.require_tags, tag)) request.exclude_tags.push_back(tag);
+      }
+      if (tags.size() && random.P(0.3)) request.sample_tags.push_back(random_tag());
+      if (random.P(0.25)) request.avoid_files.push_back(avoid_files[random.GetUInt(4)]);
+
+      // Ask for no more than half of the questions that could be chosen.
+      size_t available = 0;
+      for (size_t pos = 0; pos < qbank.GetSize(); ++pos) {
+        const Question & q = qbank.GetQuestionAt(pos);
+        bool ok = true;
+        for (const String & tag : request.require_tags) ok &= q.HasTag(tag);
+        for (const String & tag : request.exclude_tags) ok &= !q.HasTag(tag);
+        available += ok;
+      }
+      request.generate_count = 1 + random.GetUInt(std::clamp<size_t>(available / 2, 1, 40));
+    }
+    return mix;
+  }
+
+  /// Key for the rendered response to an exam request, or 0 if the request is not fully
+  /// determined by its spec and the bank (it has no fixed seed), so it cannot be reused.
+  uint64_t GetResponseKey(const ExamSpec & exam_spec) const {
+    if (exam_spec.random_seed == -1) return 0;
+    Hasher hasher;
+    hasher.Add(selection_cache.GetSnapshot(), QBL_RENDER_VERSION, exam_spec.format,
+               exam_spec.order, exam_spec.title, exam_spec.base_filename, exam_spec.generate_count,
+               exam_spec.random_seed, exam_spec.compressed_format);
+    SelectionCache::AddTags(hasher, SelectionCache::Normalize(exam_spec.include_tags));
+    SelectionCache::AddTags(hasher, SelectionCache::Normalize(exam_spec.exclude_tags));
+    SelectionCache::AddTags(hasher, SelectionCache::Normalize(exam_spec.require_tags));
+    SelectionCache::AddTags(hasher, exam_spec.sample_tags);    // Order and repeats matter here.
+    for (const String & filename : exam_spec.avoid_files) {    // Avoid lists may be rewritten.
+      std::ifstream file(filename.str());
+      std::stringstream ss;
+      ss << file.rdbuf();
+      const std::string content = ss.str();
+      hasher.Add(filename, std::string_view(content));
+    }
+    return hasher.Get();
+  }
+
+  /// Serve one exam request entirely in memory, as a resident QBL would, timing selection
+  /// (choosing questions and generating their variants) apart from rendering.  Responses to
+  /// requests with a fixed seed are cached, so a repeated request is only looked up.
+  LoadTest::Timing ServeRequest(const ExamSpec & exam_spec, std::ostream & os) const {
+    using clock_t = std::chrono::steady_clock;
+    const auto start_time = clock_t::now();
+    const uint64_t response_key = GetResponseKey(exam_spec);
+    if (response_key && selection_cache.LookupResponse(response_key, os)) {
+      const std::chrono::duration<double, std::milli> lookup_ms = clock_t::now() - start_time;
+      metrics.Observe(Metrics::Phase::REQUEST, lookup_ms.count());
+      return { lookup_ms.count(), 0.0 };
+    }
+
+    QuestionBank exam;
+    BuildExam(exam_spec, exam);
+    const auto select_time = clock_t::now();
+    std::stringstream response;
+    std::ostream & out = response_key ? response : os;
+    if (exam_spec.format == Format::WEB) PrintWeb(exam, exam_spec, out, out, out);
+    else Print(exam, exam_spec, exam_spec.format, out);
+    if (response_key) {
+      const std::string text = response.str();
+      selection_cache.StoreResponse(response_key, text);
+      os << text;
+    }
+    const std::chrono::duration<double, std::milli> select_ms = select_time - start_time;
+    const std::chrono::duration<double, std::milli> render_ms = clock_t::now() - select_time;
+    metrics.Observe(Metrics::Phase::RENDER, render_ms.count());
+    metrics.Observe(Metrics::Phase::REQUEST, select_ms.count() + render_ms.count());
+    return { select_ms.count(), render_ms.count() };
+  }
+
+  /// Load the bank once, then send it a stream of exam requests from several clients at once
+  /// and report throughput and latency percentiles.  Requests cycle through the jobs in the
+  /// batch file (-b) if there is one, or else a mix built from the bank; each uses its own
+  /// seed.  Exams are rendered in memory; a built mix writes its avoid lists to a fresh
+  /// temporary directory, removed afterward.  Returns the exit code for QBL.
+  int RunLoadTest() {
+    LoadFiles();
+    Validate();
+    StartMetrics();
+    if (qbank.GetSize() == 0) {
+      emp::notify::Error("Load test needs a question bank; no questions were loaded.");
+      return 1;
+    }
+
+    std::string avoid_dir;               // Unique to this run, so load tests can run at once.
+    emp::vector<ExamSpec> mix;
+    if (batch_filename.size()) {
+      for (const String & line : LoadBatchLines()) {
+        mix.emplace_back().ProcessArgs(ExamSpec::SplitArgs(line));
+      }
+    }
+    else {
+      avoid_dir = (std::filesystem::temp_directory_path() / "qbl-loadgen-XXXXXX").string();
+      if (!mkdtemp(avoid_dir.data())) {
+        emp::notify::Error("Unable to create a temporary directory for load test avoid lists.");
+        return 1;
+      }
+      mix = MakeLoadMix(64, avoid_dir);
+    }
+    if (mix.empty()) {
+      emp::notify::Error("Load test has no requests to send.");
+      return 1;
+    }
+
+    std::cout << "Sending " << loadgen_requests << " requests (" << mix.size()
+              << " kinds) to a bank of " << qbank.GetSize() << " questions, using "
+              << scheduler->GetThreadCount() << " worker threads." << std::endl;
+    LoadTest test;
+    test.Run(loadgen_requests, loadgen_clients, [&](size_t request_id){
+      ExamSpec request = mix[request_id % mix.size()];
+      if (request.random_seed == -1) {       // Jobs with their own seed (-S) repeat exactly.
+        request.random_seed = static_cast<int>(request_id % (INT_MAX - 1)) + 1;
+      }
+      thread_local RenderBuffer buffer;   // Reused by each client, as a server would.
+      buffer.Clear();
+      return ServeRequest(request, buffer);
+    });
+    test.PrintReport();
+    selection_cache.PrintStats(std::cout);
+
+    std::error_code ec;
+    if (avoid_dir.size()) std::filesystem::remove_all(avoid_dir, ec);
+    return 0;
+  }
+
+  bool IsServing() const { return serve_port; }
+
+  /// Serve a live preview of the web output on localhost, rendered into memory (nothing is
+  /// written to disk).  Question files and assets are checked for changes every 50 ms; after
+  /// an edit the bank is reloaded and the exam re-rendered, and open pages reload if their
+  /// questions changed.  The same seed is kept throughout, so the exam only changes where
+  /// questions were edited.  Runs until stopped; returns the exit code for QBL on failure.
+  int RunServe() {
+    ExamSpec preview_spec = spec;
+    preview_spec.format = Format::WEB;
+    if (!preview_spec.HasOutputFile()) preview_spec.base_filename = "quiz";
+    if (preview_spec.random_seed == -1) preview_spec.random_seed = emp::Random().GetSeed();
+
+    PreviewServer server(static_cast<uint16_t>(serve_port));
+    if (!server.Start()) return 1;
+
+    // Most reloads change only a few questions, so keep the rest rendered (in memory, unless
+    // a cache file was given).
+    if (!render_cache) render_cache = emp::NewPtr<RenderCache>("", cache_mb * 1024 * 1024);
+
+    // Every file the bank was loaded from (question files, then assets), with the time each
+    // was last modified when it was loaded.  Only files not watched before need to be checked
+    // when the list is updated; the rest are kept up to date by each scan.
+    emp::vector<String> watched;
+    emp::vector<std::filesystem::file_time_type> mtimes;
+    auto get_mtime = [](const String & filename){
+      std::error_code ec;
+      return std::filesystem::last_write_time(filename.str(), ec);
+    };
+    auto watch = [&](){
+      emp::vector<String> files = qbank.GetSourceFiles();
+      const AssetStore & assets = qbank.GetAssetStore();
+      for (const String & path : assets.GetPaths()) files.push_back(assets.GetSource(path));
+      mtimes.resize(files.size());
+      for (size_t i = 0; i < files.size(); ++i) {
+        if (i >= watched.size() || files[i] != watched[i]) mtimes[i] = get_mtime(files[i]);
+      }
+      watched = std::move(files);
+    };
+
+    // The ETag for each page is a hash of the content hashes of the questions on it.
+    std::string html, js, css, etag, asset_body, metrics_body;
+    auto render = [&](){
+      QuestionBank exam;
+      BuildExam(preview_spec, exam);
+      const auto render_start = std::chrono::steady_clock::now();
+      std::stringstream html_out, js_out, css_out;
+      PrintWeb(exam, preview_spec, html_out, js_out, css_out);
+      const std::chrono::duration<double, std::milli> render_ms =
+        std::chrono::steady_clock::now() - render_start;
+      metrics.Observe(Metrics::Phase::RENDER, render_ms.count());
+      html = html_out.str();
+      const size_t body_end = std::min(html.rfind("</body>"), html.size());
+      html.insert(body_end, PreviewServer::reload_script);
+      js = js_out.str();
+      css = css_out.str();
+      Hasher hasher;
+      hasher.Add(QBL_RENDER_VERSION, preview_spec.title, exam.GetSize());
+      for (size_t pos = 0; pos < exam.GetSize(); ++pos) {
+        hasher.Add(exam.GetQuestionAt(pos).GetContentHash());
+      }
+      etag = hasher.GetHex().str();
     };
 
-    return "Unknown!";
+    const String base = "/" + preview_spec.base_filename;
+    auto get_page = [&](const String & path, PreviewServer::Page & page){
+      auto set_page = [&](const std::string & body, const char * suffix){
+        page = { PreviewServer::GetMimeType(suffix), body, emp::MakeString('"', etag, suffix, '"') };
+      };
+      if (path == "/" || path == base + ".html") set_page(html, ".html");
+      else if (path == base + ".js") set_page(js, ".js");
+      else if (path == base + ".css") set_page(css, ".css");
+      else if (path == "/metrics") {
+        std::stringstream ss;
+        metrics.Write(ss);
+        metrics_body = ss.str();
+        page = { "text/plain; version=0.0.4; charset=utf-8", metrics_body, "" };
+      }
+      else {      // Assets are named by their content hash, so the name is the ETag.
+        const String source = qbank.GetAssetStore().GetSource(path.substr(1));
+        std::ifstream file(source.str(), std::ios::binary);
+        if (source.empty() || !file) return false;
+        std::stringstream ss;
+        ss << file.rdbuf();
+        asset_body = ss.str();
+        page = { PreviewServer::GetMimeType(path), asset_body, emp::MakeString('"', path, '"') };
+      }
+      return true;
+    };
+
+    // Reload the bank and re-render; returns true if the preview changed.  Only the files
+    // that changed are reparsed, unless the whole bank must be reloaded.
+    auto reload = [&](const std::set<String> & changed){
+      const auto start_time = std::chrono::steady_clock::now();
+      const size_t start_reindex = tag_index.GetReindexCount();
+      if (changed.empty() || !qbank.ReloadFiles(changed)) {
+        qbank.Clear();
+        LoadFiles();
+        Validate();
+        watched.clear();
+      }
+      watch();
+      const std::string old_etag = etag;
+      render();
+      const std::chrono::duration<double, std::milli> reload_ms =
+        std::chrono::steady_clock::now() - start_time;
+      metrics.Observe(Metrics::Phase::RELOAD, reload_ms.count());
+      std::cout << "Loaded " << qbank.GetSize() << " questions (reindexed "
+                << (tag_index.GetReindexCount() - start_reindex) << ") and rendered the preview in "
+                << std::fixed << std::setprecision(1) << reload_ms.count() << " ms." << std::endl;
+      return etag != old_etag;
+    };
+
+    // Files are checked for changes every SCAN_MS.  The metrics file is written from here
+    // too, so it never reads the bank mid-reload.
+    constexpr int SCAN_MS = 100;
+    auto next_metrics_time = std::chrono::steady_clock::now();
+    auto check = [&](){
+      if (metrics_filename.size() && std::chrono::steady_clock::now() >= next_metrics_time) {
+        metrics.WriteFile(metrics_filename);
+        next_metrics_time += std::chrono::seconds(1);
+      }
+      std::set<String> changed;
+      for (size_t i = 0; i < watched.size(); ++i) {
+        const auto mtime = get_mtime(watched[i]);
+        if (mtime == mtimes[i]) continue;
+        mtimes[i] = mtime;
+        changed.insert(watched[i]);
+      }
+      return changed.size() && reload(changed);
+    };
+
+    reload({});
+    std::cout << "Previewing at http://localhost:" << serve_port << "/ (Ctrl-C to stop)."
+              << std::endl;
+    server.Run(get_page, check, SCAN_MS);
+    return 0;
   }
 
-  void LoadFiles() {
-    for (auto filename : question_files) {
-      qbank.NewFile(filename);   // Let the question bank know we are loading from a new file.
-      emp::File file(filename);
-      file.RemoveIfBegins("%");  // Remove all comment lines.
-
-      for (const emp::String & line : file) {
-        if (line.OnlyWhitespace()) { qbank.NewEntry(); continue; }
-        qbank.AddLine(line);
+  /// Start rewriting the metrics file (if requested) in the background; the bank must be
+  /// fully loaded, since it is read from another thread from then on.
+  void StartMetrics() {
+    if (metrics_filename.size()) metrics.StartFile(metrics_filename);
+  }
+
+  /// Write the metrics that are read at scrape time: the bank, caches, memory, and workers.
+  void WriteMetrics(std::ostream & os) const {
+    std::stringstream snapshot;
+    snapshot << "snapshot=\"" << std::hex << std::setw(16) << std::setfill('0')
+             << selection_cache.GetSnapshot() << '"';
+    Metrics::WriteMetric(os, "qbl_bank_info", "gauge", "Snapshot hash of the question bank.",
+                         {{snapshot.str(), 1}});
+    Metrics::WriteMetric(os, "qbl_questions", "gauge", "Questions in the bank.",
+                         {{"", static_cast<double>(qbank.GetSize())}});
+    Metrics::WriteMetric(os, "qbl_tags", "gauge", "Distinct tags in the tag index.",
+                         {{"", static_cast<double>(tag_index.GetTagCount())}});
+    Metrics::WriteMetric(os, "qbl_tag_index_tombstones", "gauge",
+                         "Removed questions still holding a tag index slot.",
+                         {{"", static_cast<double>(tag_index.GetTombstoneCount())}});
+    Metrics::WriteMetric(os, "qbl_tag_index_reindexed_total", "counter",
+                         "Questions added to or updated in the tag index.",
+                         {{"", static_cast<double>(tag_index.GetReindexCount())}});
+
+    emp::vector<std::pair<std::string, double>> hits, misses, memory;
+    auto add_cache = [&](const char * name, size_t hit_count, size_t miss_count){
+      hits.emplace_back(emp::MakeString("cache=\"", name, '"').str(), hit_count);
+      misses.emplace_back(emp::MakeString("cache=\"", name, '"').str(), miss_count);
+    };
+    const SelectionCache::Stats candidate_stats = selection_cache.GetCandidateStats();
+    const SelectionCache::Stats response_stats = selection_cache.GetResponseStats();
+    add_cache("candidates", candidate_stats.hits, candidate_stats.misses);
+    add_cache("responses", response_stats.hits, response_stats.misses);
+    if (render_cache) {
+      add_cache("render", render_cache->GetHitCount(), render_cache->GetMissCount());
+    }
+    Metrics::WriteMetric(os, "qbl_cache_hits_total", "counter", "Lookups found in each cache.",
+                         hits);
+    Metrics::WriteMetric(os, "qbl_cache_misses_total", "counter", "Lookups missed by each cache.",
+                         misses);
+
+    memory.emplace_back("subsystem=\"process\"", Metrics::GetProcessMemory());
+    memory.emplace_back("subsystem=\"tag_index\"", tag_index.GetMemoryBytes());
+    memory.emplace_back("subsystem=\"selection_cache\"", selection_cache.GetMemoryBytes());
+    if (render_cache) {
+      memory.emplace_back("subsystem=\"render_cache\"", render_cache->GetMemoryBytes());
+    }
+    Metrics::WriteMetric(os, "qbl_memory_bytes", "gauge",
+                         "Memory used (resident for the process; approximate otherwise).", memory);
+
+    Metrics::WriteMetric(os, "qbl_worker_threads", "gauge", "Threads running scheduled work.",
+                         {{"", static_cast<double>(scheduler->GetThreadCount())}});
+    Metrics::WriteMetric(os, "qbl_worker_busy_seconds_total", "counter",
+                         "Time spent running tasks, summed over worker threads.",
+                         {{"", scheduler->GetBusySeconds()}});
+    Metrics::WriteMetric(os, "qbl_worker_tasks_total", "counter", "Tasks run by worker threads.",
+                         {{"", static_cast<double>(scheduler->GetTaskCount())}});
+  }
+
+  bool IsCoordinator() const { return batch_filename.size() && shard_count > 1; }
+
+  /// Arguments for each shard worker: this command line as given (so workers load the same
+  /// question files with the same settings), minus the flags for the batch itself; the
+  /// coordinator gives each worker its own batch and report.  Metrics are left out too, as
+  /// workers would overwrite one another's file.
+  emp::vector<String> GetWorkerArgs() const {
+    const std::set<String> batch_flags{ "-b", "--batch", "-B", "--batch-report", "-P",
+                                        "--shards", "-m", "--metrics" };
+    emp::vector<String> worker_args;
+    for (size_t i = 1; i < command_line.size(); ++i) {
+      if (batch_flags.contains(command_line[i])) ++i;   // Skip the flag and its argument.
+      else worker_args.push_back(command_line[i]);
+    }
+    return worker_args;
+  }
+
+  /// Split the batch file across worker processes, each loading the same question files.
+  /// Jobs are checked against each other before they are split up, since jobs in different
+  /// shards can also clobber each other's output.  Returns the exit code for QBL.
+  int RunShards() const {
+    const String report_file = batch_report.size() ? batch_report : String(batch_filename + ".report");
+    const emp::vector<String> job_lines = LoadBatchLines();
+    emp::vector<String> job_status;
+    const emp::vector<ExamSpec> jobs = ParseBatchJobs(job_lines, job_status);
+    std::map<size_t, String> skipped;   // Jobs not to run -> rest of their report line
+    for (size_t job_id = 0; job_id < jobs.size(); ++job_id) {
+      if (job_status[job_id] == "ok") continue;
+      skipped[job_id] = emp::MakeString(job_status[job_id], "\t0\t",
+                                        jobs[job_id].GetOutputFilename());
+    }
+    ShardCoordinator coordinator(flags[0], GetWorkerArgs(), batch_filename + ".shards");
+    const bool ok = coordinator.Run(job_lines, skipped, shard_count, report_file);
+    return ok ? 0 : 1;
+  }
+
+  /// Can questions be written out as they are loaded?  That requires an output where each
+  /// question renders independently, in load order, with nothing chosen across the whole bank.
+  bool CanPipeline() const {
+    if (batch_filename.size() || render_cache || spec.log_filename.size()) return false;
+    if (emit_cpp_filename.size() || spec.manifest_filename.size() || variant_count) return false;
+    if (spec.generate_count || spec.order != Order::DEFAULT || spec.split_fragments) return false;
+    if (metrics_filename.size()) return false;   // Metrics time each phase separately.
+    switch (spec.format) {
+      case Format::QBL: case Format::NONE: case Format::D2L:
+      case Format::GRADESCOPE: case Format::LATEX:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  void PrintQuestion(const Question & q, size_t q_num, std::ostream & os) const {
+    const char * format = "";         // Only Latex formats have question wrappers.
+    if (spec.format == Format::LATEX) format = "latex";
+    if (spec.format == Format::GRADESCOPE) format = "gradescope";
+    OutputTemplate::Values values = GetTemplateValues(spec);
+    values.q_num = q_num;
+    values.id = q.GetID();
+    templates.PrintWrapped(os, format, values,
+                           [&](std::ostream & out){ _PrintQuestion(q, q_num, out); });
+  }
+
+  void _PrintQuestion(const Question & q, size_t q_num, std::ostream & os) const {
+    switch (spec.format) {
+      case Format::QBL:        q.Print(os); break;
+      case Format::NONE:       q.Print(os); break;
+      case Format::D2L:        q.PrintD2L(os); break;
+      case Format::GRADESCOPE: q.PrintGradeScope(os, q_num, spec.compressed_format); break;
+      case Format::LATEX:      q.PrintLatex(os); break;
+      default: emp::notify::Error("Format cannot be printed one question at a time.");
+    }
+  }
+
+  /// Load, validate, render, and write questions in overlapping stages: as the parser
+  /// finishes each question, it becomes a scheduler task that validates and renders it, and
+  /// rendered questions are written out in their original order as soon as all earlier
+  /// questions are done, while later files are still being loaded.  At most a few questions
+  /// per thread are held between parsing and writing, so memory use does not grow with the
+  /// size of the bank (beyond the output itself, when it goes to a file).
+  void RunPipeline() {
+    struct Slot {
+      String text;
+      DiagnosticLog log;                // Reported when the question is written.
+      std::atomic<bool> ready = false;
+    };
+    std::deque<Slot> slots;             // Questions in flight, in load order (never moved).
+    size_t written_count = 0;           // Questions already written (and removed from slots).
+    const size_t max_in_flight = 4 * scheduler->GetThreadCount();
+    Scheduler::TaskGroup tasks;
+
+    // Write to standard output as questions arrive; files are only replaced once complete.
+    std::stringstream file_out;
+    std::ostream & os = spec.HasOutputFile() ? file_out : std::cout;
+    // Split output is handed to the part writer instead, one question at a time.
+    emp::Ptr<PartWriter> parts = nullptr;
+    if (spec.IsSplitParts()) {
+      parts = emp::NewPtr<PartWriter>(spec.base_path, spec.base_filename, spec.extension,
+                                      spec.part_kb * 1024, spec.part_rows, *scheduler);
+    }
+    auto write_ready = [&](){
+      while (slots.size() && slots.front().ready.load(std::memory_order_acquire)) {
+        Slot & slot = slots.front();
+        slot.log.Report();
+        if (parts) parts->Add(slot.text.str());
+        else os << slot.text;
+        slots.pop_front();
+        ++written_count;
+      }
+    };
+
+    PrintHeader(spec, os);
+    qbank.SetOnQuestionDone([&](emp::Ptr<Question> q){
+      // Only a few questions are in flight at once; if the oldest is still being rendered,
+      // help run tasks until it is done, so loading never runs far ahead of writing.
+      if (slots.size() >= max_in_flight) {
+        scheduler->WaitUntil([&](){ return slots.front().ready.load(std::memory_order_acquire); });
+        write_ready();
       }
+      Slot & slot = slots.emplace_back();
+      const size_t q_num = written_count + slots.size();
+      scheduler->Run(tasks, [this, q, q_num, &slot](){
+        std::stringstream ss;
+        slot.log.Capture([this, q, q_num, &ss](){
+          q->Validate();
+          PrintQuestion(*q, q_num, ss);
+        });
+        slot.text = ss.str();
+        slot.ready.store(true, std::memory_order_release);
+      });
+      write_ready();
+    });
+    LoadFiles();
+    scheduler->Wait(tasks);
+    write_ready();
+    PrintFooter(spec, os);
+
+    if (parts) {
+      FinishParts(*parts, spec, ExportAssets(qbank.GetAssetPaths(), spec));
+      parts.Delete();
+    }
+    else if (spec.HasOutputFile()) {
+      ExportAssets(qbank.GetAssetPaths(), spec);
+      const bool changed = WriteIfChanged(spec.GetOutputFilename(), file_out.str());
+      std::cout << "Updated " << (changed ? 1 : 0) << " of 1 output files for '"
+                << spec.GetOutputFilename() << "'." << std::endl;
     }
   }
 
-  void Generate() {
-    qbank.Validate();
-    if (generate_count) {
-      qbank.Generate(generate_count, random, include_tags, exclude_tags, 
-          require_tags, sample_tags, avoid_files);
+  /// Save the loaded questions as a header for `make embedded`, instead of building an exam.
+  void EmitCpp() const {
+    std::stringstream ss;
+    qbank.PrintCpp(ss);
+    const bool changed = WriteIfChanged(emit_cpp_filename, ss.str());
+    std::cout << (changed ? "Wrote " : "Unchanged: ") << qbank.GetSize() << " questions to '"
+              << emit_cpp_filename << "' (loaded in " << std::fixed << std::setprecision(2)
+              << load_ms << " ms)." << std::endl;
+  }
+
+  void Run() const {
+    if (emit_cpp_filename.size()) { EmitCpp(); return; }
+    if (variant_count) { RunVariants(); return; }
+    if (batch_filename.size()) RunBatch();
+    else RunExam(spec);
+
+    // Report cache use, unless the exam itself went to standard output.
+    if (render_cache && (batch_filename.size() || spec.HasOutputFile())) {
+      std::cout << "Render cache: " << render_cache->GetHitCount() << " hits, "
+                << render_cache->GetMissCount() << " misses." << std::endl;
     }
+    if (batch_filename.size()) selection_cache.PrintStats(std::cout);
+  }
+
+  static OutputTemplate::Values GetTemplateValues(const ExamSpec & exam_spec) {
+    OutputTemplate::Values values;
+    values.title = exam_spec.title.str();
+    values.base = exam_spec.base_filename.str();
+    return values;
+  }
+
+  void PrintTemplate(const String & name, const ExamSpec & exam_spec, std::ostream & os) const {
+    templates.Get(name).Render(os, GetTemplateValues(exam_spec));
+  }
+
+  /// Print the document header (or footer) template for a Latex or GradeScope exam.
+  void PrintHeader(const ExamSpec & exam_spec, std::ostream & os) const {
+    if (exam_spec.format == Format::LATEX) PrintTemplate("latex_header", exam_spec, os);
+    if (exam_spec.format == Format::GRADESCOPE) PrintTemplate("gradescope_header", exam_spec, os);
+  }
+  void PrintFooter(const ExamSpec & exam_spec, std::ostream & os) const {
+    if (exam_spec.format == Format::LATEX) PrintTemplate("latex_footer", exam_spec, os);
+    if (exam_spec.format == Format::GRADESCOPE) PrintTemplate("gradescope_footer", exam_spec, os);
   }
 
-  void Print(Format out_format, std::ostream & os=std::cout) const {
+  void Print(const QuestionBank & exam, const ExamSpec & exam_spec, Format out_format,
+             std::ostream & os=std::cout) const {
     switch (out_format) {
-      case Format::QBL:        qbank.Print(os); break;
-      case Format::NONE:       qbank.Print(os); break;
-      case Format::D2L:        qbank.PrintD2L(os); break;
-      case Format::GRADESCOPE: qbank.PrintGradeScope(os, compressed_format); break;
-      case Format::LATEX:      qbank.PrintLatex(os); break;
+      case Format::QBL:        exam.Print(os); break;
+      case Format::NONE:       exam.Print(os); break;
+      case Format::D2L:        exam.PrintD2L(os); break;
+      case Format::GRADESCOPE:
+        PrintHeader(exam_spec, os);
+        exam.PrintGradeScope(os, exam_spec.compressed_format);
+        PrintFooter(exam_spec, os);
+        break;
+      case Format::LATEX:
+        PrintHeader(exam_spec, os);
+        exam.PrintLatex(os);
+        PrintFooter(exam_spec, os);
+        break;
       case Format::WEB:        emp::notify::Error("Web output must go to files."); break;
-      case Format::DEBUG:      PrintDebug(os); break;
+      case Format::DEBUG:      PrintDebug(exam, exam_spec, os); break;
     }
   }
 
-  void Print() const {
+  void Print(const QuestionBank & exam, const ExamSpec & exam_spec,
+             std::ostream & msg_out=std::cout) const {
     // If we are supposed to save a log of questions, do so.
-    if (log_filename.size()) {
-      qbank.LogQuestions(log_filename);
+    if (exam_spec.log_filename.size()) {
+      exam.LogQuestions(exam_spec.log_filename);
     }
 
     // If there is no filename, just print to standard out.
-    if (!base_filename.size()) { Print(format); return; }
-
-    std::ofstream main_file(base_path + base_filename + extension);
-    if (format == Format::WEB) {
-      std::ofstream js_file(base_path + base_filename + ".js");
-      std::ofstream css_file(base_path + base_filename + ".css");
-      PrintWeb(main_file, js_file, css_file);
-    }
-    else Print(format, main_file);
-  }
-
-  void PrintWeb(std::ostream & html_out, std::ostream & js_out, std::ostream & css_out) const {
-    // Print the header for the HTML file.
-    html_out
-    << "<!DOCTYPE html>\n"
-    << "<html lang=\"en\">\n"
-    << "<head>\n"
-    << "  <meta charset=\"UTF-8\">\n"
-    << "  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
-    << "  <title>" << title << "</title>\n"
-    << "  <link rel=\"stylesheet\" href=\"" << base_filename << ".css\">\n"
-    << "</head>\n"
-    << "<body>\n"
-    << "\n"
-    << "<form id=\"quizForm\">\n"
-    << "  <h1>" << title << "</h1>\n"
-    << "\n";
-
-    qbank.PrintHTML(html_out);
-
-    // Print Footer for the HTML file.
-    html_out
-    << "  <hr><p>\n"
-    << "  Click <b>Check Answers</b> to identify any errors and try again.  Click <b>Show Answers</b> if you also want to know which answer is the correct one.\n"
-    << "  </p>\n"
-    << "  <button type=\"button\" id=\"checkAnswersBtn\">Check Answers</button>\n"
-    << "  <button type=\"button\" id=\"showAnswersBtn\">Show Answers</button>\n"
-    << "</form>\n"
-    << "<div id=\"results\"></div>\n"
-    << "<script src=\"" << base_filename << ".js\"></script>\n"
-    << "</body>\n"
-    << "</html>\n";
-
-    // Print Header for the JS file.
-    js_out
-    << "// Fetch all the radio buttons in the quiz\n"
-    << "let radioButtons = document.querySelectorAll('input[type=\"radio\"]');\n"
-    << "\n"
-    << "// Add a click event to each radio button\n"
-    << "radioButtons.forEach(button => {\n"
-    << "  button.addEventListener('click', function() { clearResults(button.name); });\n"
-    << "});\n"
-    << "\n"
-    << "function clearResults(button_name) {\n"
-    << "  // Clear main results\n"
-    << "  document.getElementById('results').innerHTML = '';\n"
-    << "\n"
-    << "  // Clear answers displayed beneath each question\n"
-    << "  let answerDiv = document.querySelector(`.answer[data-question=\"${button_name}\"]`);\n"
-    << "  answerDiv.innerHTML = \"\";\n"
-    << "}\n"
-    << "\n"
-    << "function PrintResults(show_correct) {"
-    << "  event.preventDefault(); // Prevent form from submitting to a server\n"
-    << "  let correctAnswers = {\n";
-
-    qbank.PrintJS(js_out);
-
-    // Print Footer for the JS file.
-    js_out
-    << "  };\n"
-
-    << "\n"
-    << "  let userAnswers = {};\n"
-    << "  for (let key in correctAnswers) {\n"
-    << "    let selectedAnswer = document.querySelector(`input[name=\"${key}\"]:checked`);\n"
-    << "    userAnswers[key] = selectedAnswer ? selectedAnswer.value : \"\";\n"
-    << "  }\n"
-    << "\n"
-    << "  let score = 0;\n"
-    << "  let results = [];\n"
-    << "\n"
-    << "  for (let key in correctAnswers) {\n"
-    << "    if (userAnswers[key] === correctAnswers[key]) {\n"
-    << "      score++;\n"
-    << "      results.push({\n"
-    << "        question: key,\n"
-    << "        status: 1,\n"
-    << "        correctAnswer: correctAnswers[key]\n"
-    << "      });\n"
-    << "    } else {\n"
-    << "      results.push({\n"
-    << "        question: key,\n"
-    << "        status: 0,\n"
-    << "        correctAnswer: correctAnswers[key]\n"
-    << "      });\n"
-    << "    }\n"
-    << "  }\n"
-    << "\n"
-    << "  displayResults(score, results, show_correct);\n"
-    << "};\n"
-    << "\n"
-
-    << "function displayResults(score, results, show_correct) {\n"
-    << "  let resultsDiv = document.getElementById('results');\n"
-    << "  resultsDiv.innerHTML = `<p>You got ${score} out of ${Object.keys(results).length} correct!</p>`;\n"
-    << "\n"
-    << "  // Reset all answer texts\n"
-    << "  let answerDivs = document.querySelectorAll('.answer');\n"
-    << "  answerDivs.forEach(div => div.innerHTML = \"\");\n"
-    << "\n"
-    << "  results.forEach(item => {\n"
-    << "    let answerDiv = document.querySelector(`.answer[data-question=\"${item.question}\"]`);\n"
-    << "    if (item.status === 0) {\n"
-    << "      if (show_correct) {\n"
-    << "        answerDiv.innerHTML = `<b>Incorrect</b>. The correct answer is: ${item.correctAnswer}`;\n"
-    << "      } else {\n"
-    << "        answerDiv.innerHTML = `<b>Incorrect</b>.`;\n"
-    << "      }\n"
-    << "      answerDiv.style.color = \"red\";\n"
-    << "    } else {\n"
-    << "      answerDiv.innerHTML = `<b>Correct!</b>`;\n"
-    << "      answerDiv.style.color = \"green\";\n"
-    << "    }\n"
-    << "  });\n"
-    << "};\n"
-    << "\n"
-    << "document.getElementById('showAnswersBtn').addEventListener('click', function() {\n"
-//    << "document.getElementById('quizForm').addEventListener('submit', function(event) {\n"
-    << "  PrintResults(1);\n"
-    << "});\n"
-    << "\n"
-    << "document.getElementById('checkAnswersBtn').addEventListener('click', function() {\n"
-    << "  PrintResults(0);\n"
-    << "});\n";
-
-    // Print the CSS file.
-    css_out
-    << "body {\n"
-    << "  font-family: Arial, sans-serif;\n"
-    << "  margin: 50px;\n"
-    << "}\n"
-    << "\n"
-    << ".question {\n"
-    << "  margin-bottom: 20px;\n"
-    << "  color: black;\n"
-    << "}\n"
-    << ".options {\n"
-    << "  color: #000088;\n"
-    << "}\n"
-    << "\n"
-    << "label {\n"
-    << "  display: block;\n"
-    << "  margin-bottom: 5px;\n"
-    << "}\n"
-    << "\n"
-    << "input[type=\"submit\"] {\n"
-    << "  padding: 10px 15px;\n"
-    << "  background-color: #007BFF;\n"
-    << "  color: white;\n"
-    << "  border: none;\n"
-    << "  cursor: pointer;\n"
-    << "}\n"
-    << "\n"
-    << "input[type=\"submit\"]:hover {\n"
-    << "  background-color: #0056b3;\n"
-    << "}\n";
-  }
-
-  void PrintDebug(std::ostream & os=std::cout) const {
-   os << "Question Files: " << emp::MakeLiteral(question_files) << "\n"
-      << "Base filename: " << base_filename << "\n"
-      << "... extension: " << extension << "\n"
-      << "Output Format: " << GetFormatName(format) << "\n"
-      << "Include tags: " << emp::MakeLiteral(include_tags) << "\n"
-      << "Exclude tags: " << emp::MakeLiteral(exclude_tags) << "\n"
-      << "Required tags: " << emp::MakeLiteral(require_tags) << "\n"
-      << "Sampled tags: " << emp::MakeLiteral(sample_tags) << "\n"
-      << "----------\n";
-    qbank.PrintDebug(os);
+    if (!exam_spec.HasOutputFile()) { Print(exam, exam_spec, exam_spec.format); return; }
+    if (exam_spec.IsSplitParts()) { PrintParts(exam, exam_spec, msg_out); return; }
+
+    // Render everything to memory first; only files whose contents changed are rewritten.
+    size_t changed_count = 0, file_count = 0;
+    auto write_file = [&](const String & filename, const std::stringstream & ss) {
+      ++file_count;
+      if (WriteIfChanged(filename, ss.str())) ++changed_count;
+    };
+
+    const String file_base = exam_spec.base_path + exam_spec.base_filename;
+    const bool is_latex = exam_spec.format == Format::LATEX || exam_spec.format == Format::GRADESCOPE;
+    std::stringstream main_out;
+    if (exam_spec.format == Format::WEB) {
+      std::stringstream js_out, css_out;
+      PrintWeb(exam, exam_spec, main_out, js_out, css_out);
+      write_file(file_base + ".js", js_out);
+      write_file(file_base + ".css", css_out);
+    }
+    else if (is_latex && exam_spec.split_fragments) {
+      PrintFragments(exam, exam_spec, main_out, write_file);
+    }
+    else Print(exam, exam_spec, exam_spec.format, main_out);
+    write_file(exam_spec.GetOutputFilename(), main_out);
+    const size_t asset_count = ExportAssets(exam.GetAssetPaths(), exam_spec);
+
+    msg_out << "Updated " << changed_count << " of " << file_count << " output files for '"
+            << exam_spec.GetOutputFilename() << "'";
+    if (asset_count) msg_out << " (and placed " << asset_count << " new assets)";
+    msg_out << "." << std::endl;
+  }
+
+  /// Write D2L output as part files that each stay within the spec's size and row limits,
+  /// plus an index of the parts.  Questions are rendered a block at a time (in parallel) and
+  /// passed on to be written, so only a few parts are ever held in memory.
+  void PrintParts(const QuestionBank & exam, const ExamSpec & exam_spec,
+                  std::ostream & msg_out=std::cout) const {
+    PartWriter parts(exam_spec.base_path, exam_spec.base_filename, exam_spec.extension,
+                     exam_spec.part_kb * 1024, exam_spec.part_rows, *scheduler);
+    constexpr size_t block_size = 256;
+    for (size_t start = 0; start < exam.GetSize(); start += block_size) {
+      const size_t count = std::min(block_size, exam.GetSize() - start);
+      emp::vector<DiagnosticLog> logs(count);
+      auto texts = scheduler->ParallelMap<std::string>(count, [&exam, &logs, start](size_t i){
+        std::stringstream ss;
+        logs[i].Capture([&exam, &ss, start, i](){ exam.PrintD2LQuestion(ss, start + i); });
+        return ss.str();
+      });
+      for (DiagnosticLog & log : logs) log.Report();
+      for (const std::string & text : texts) parts.Add(text);
+    }
+    FinishParts(parts, exam_spec, ExportAssets(exam.GetAssetPaths(), exam_spec), msg_out);
+  }
+
+  void FinishParts(PartWriter & parts, const ExamSpec & exam_spec, size_t asset_count,
+                   std::ostream & msg_out=std::cout) const {
+    const size_t changed_count = parts.Finish();
+    msg_out << "Updated " << changed_count << " of " << (parts.GetParts().size() + 1)
+            << " output files for '" << exam_spec.base_path << parts.GetIndexName() << "' ("
+            << parts.GetParts().size() << " parts)";
+    if (asset_count) msg_out << " (and placed " << asset_count << " new assets)";
+    msg_out << "." << std::endl;
+  }
+
+  /// Place the assets with the provided paths next to the exam's output file; returns the
+  /// number that were not already there.
+  size_t ExportAssets(const emp::vector<String> & paths, const ExamSpec & exam_spec) const {
+    if (!exam_spec.HasOutputFile()) return 0;
+    return qbank.GetAssetStore().Export(paths, exam_spec.base_path, *scheduler, hardlink_assets);
+  }
+
+  void PrintFragment(const QuestionBank & exam, const ExamSpec & exam_spec, size_t id,
+                     std::ostream & os) const {
+    if (exam_spec.format == Format::GRADESCOPE) {
+      exam.PrintGradeScopeQuestion(os, id, exam_spec.compressed_format);
+    } else {
+      exam.PrintLatexQuestion(os, id);
+    }
+  }
+
+  /// Print each Latex question to its own file, and \input them from the main output; editing
+  /// one question then only changes one fragment file.
+  template <typename WRITE_FUN>
+  void PrintFragments(const QuestionBank & exam, const ExamSpec & exam_spec,
+                      std::ostream & main_out, WRITE_FUN && write_file) const {
+    std::filesystem::create_directories(String(exam_spec.base_path + exam_spec.GetFragmentDir()).str());
+
+    PrintHeader(exam_spec, main_out);
+    for (size_t id = 0; id < exam.GetSize(); ++id) {
+      std::stringstream ss;
+      PrintFragment(exam, exam_spec, id, ss);
+      write_file(exam_spec.base_path + exam_spec.GetFragmentName(id+1) + ".tex", ss);
+      main_out << "\\input{" << exam_spec.GetFragmentName(id+1) << "}\n";
+    }
+    PrintFooter(exam_spec, main_out);
+
+    // Remove fragments left over from a previous, longer exam.
+    for (size_t q_num = exam.GetSize() + 1; ; ++q_num) {
+      const String filename = exam_spec.base_path + exam_spec.GetFragmentName(q_num) + ".tex";
+      if (!std::filesystem::remove(filename.str())) break;
+      std::filesystem::remove(HashSidecarName(filename).str());
+    }
+  }
+
+  void PrintWeb(const QuestionBank & exam, const ExamSpec & exam_spec,
+                std::ostream & html_out, std::ostream & js_out, std::ostream & css_out) const {
+    PrintTemplate("html_header", exam_spec, html_out);
+    exam.PrintHTML(html_out);
+    PrintTemplate("html_footer", exam_spec, html_out);
+
+    PrintTemplate("js_header", exam_spec, js_out);
+    exam.PrintJS(js_out);
+    PrintTemplate("js_footer", exam_spec, js_out);
+
+    PrintTemplate("css", exam_spec, css_out);
+  }
+
+  void PrintDebug(const QuestionBank & exam, const ExamSpec & exam_spec,
+                  std::ostream & os=std::cout) const {
+    os << "Question Files: " << emp::MakeLiteral(question_files) << "\n";
+#ifdef QBL_EMBEDDED_BANK
+    os << "Embedded Questions: " << qbl_embedded_bank.questions.size() << "\n";
+#endif
+    os << "Load Time: " << load_ms << " ms\n";
+    os << "Assets: " << qbank.GetAssetStore().GetSize() << " ("
+       << qbank.GetAssetStore().GetDuplicateCount() << " duplicate files)\n";
+    exam_spec.PrintDebug(os);
+    os << "----------\n";
+    qbank.PrintDebug(os, &exam.GetSelection());
+    os << "Questions in exam: " << exam.GetSize() << "\n";
   }
 };
 
@@ -450,8 +1341,14 @@ int main(int argc, char * argv[])
     exit(1);
   }
   QBL qbl(argc, argv);
+  if (qbl.IsRegen()) return qbl.RunRegen();
+  if (qbl.IsReplace()) return qbl.RunReplace();
+  if (qbl.IsLoadTest()) return qbl.RunLoadTest();
+  if (qbl.IsServing()) return qbl.RunServe();
+  if (qbl.IsCoordinator()) return qbl.RunShards();  // Workers load the questions themselves.
+  if (qbl.CanPipeline()) { qbl.RunPipeline(); return 0; }
   qbl.LoadFiles();
-  qbl.Generate();
-  qbl.UpdateOrder();
-  qbl.Print();
+  qbl.Validate();
+  qbl.StartMetrics();
+  qbl.Run();
 }
@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include "emp/base/notify.hpp"
+#include "emp/base/Ptr.hpp"
 #include "emp/base/vector.hpp"
 #include "emp/datastructs/map_utils.hpp"
 #include "emp/datastructs/vector_utils.hpp"
@@ -12,26 +13,38 @@
 #include "emp/math/Range.hpp"
 #include "emp/tools/String.hpp"
 
+#include "Asset.hpp"
+#include "Diagnostics.hpp"
 #include "functions.hpp"
+#include "Hash.hpp"
+#include "TagSet.hpp"
 
 using emp::String;
 
+// One answer option in a form that does not depend on the question type.
+struct OptionData {
+  String text;               ///< Wording for this option (or the answer, for short answer).
+  bool is_correct = true;    ///< Is this option marked as a correct answer?
+  bool is_fixed = false;     ///< Is this option in a fixed position?
+  bool is_required = false;  ///< Does this option have to be included?
+};
+
 class Question {
 protected:
   size_t id = (size_t) -1;      ///< Unique ID for this question.
+  emp::String source;           ///< Name of the file this question was loaded from.
   emp::String question;         ///< Wording for this question.
   emp::String alt_question;     ///< Toggled wording for this question.
   emp::String explanation;      ///< Explain this question to the student (usually reveals answer)
   emp::String hint;             ///< Hint to point students in the right direction.
 
-  emp::vector<String> base_tags;       ///< Tags to identify topic.
-  emp::vector<String> exclusive_tags;  ///< Tags for question groups where only one should be used.
-  std::map<String,String> config_tags; ///< Tags to specify question details (num options, etc)
+  TagSet tags;                                   ///< Tags given directly on this question.
+  emp::vector<emp::Ptr<const TagSet>> shared_tags; ///< Tag blocks shared with other questions.
+  emp::vector<AssetRef> assets;                  ///< Images and attachments (from `@` lines).
 
   size_t points = 1;          ///< How many points should this question be worth?
   bool is_required = false;   ///< Must this question be used on a generated quiz?
   bool is_fixed = false;      ///< Is this question locked into this order?
-  size_t avoid = 0;           ///< How many times should we skip this question before picking it?
 
   // Which section are we currently loading in?  Needed for multi-line entries.
   enum class Section {
@@ -43,10 +56,20 @@ protected:
   };
   Section last_edit = Section::NONE;
 
+  // Find a config value; tags on the question itself override any shared tag blocks.
+  const String * _FindConfig(const String & name) const {
+    if (const String * val = tags.FindConfig(name)) return val;
+    for (size_t i = shared_tags.size(); i-- > 0;) {
+      if (const String * val = shared_tags[i]->FindConfig(name)) return val;
+    }
+    return nullptr;
+  }
+
   template <typename T>
   T _GetConfig(String name, T default_val=T{}) const {
-    if (!emp::Has(config_tags, name)) return default_val;
-    const String & val = config_tags.find(name)->second;
+    const String * val_ptr = _FindConfig(name);
+    if (!val_ptr) return default_val;
+    const String & val = *val_ptr;
 
     // Ranges should allow a dash.
     if constexpr (std::is_same_v<T,emp::Range<size_t>>) {
@@ -62,7 +85,7 @@ protected:
 
   template <typename... Ts>
   void _Warning(Ts &&... args) const {
-    emp::notify::Warning("Question ", id, " (", question, ")", ": ",
+    DiagnosticLog::Warning("Question ", id, " (", question, ")", ": ",
                         std::forward<Ts>(args)...);
   }
 
@@ -74,7 +97,7 @@ protected:
 
   template <typename... Ts>
   void _Error(Ts &&... args) const {
-    emp::notify::Error("Question ", id, " (", question, ")", ": ",
+    DiagnosticLog::Error("Question ", id, " (", question, ")", ": ",
                         std::forward<Ts>(args)...);
   }
 
@@ -84,6 +107,58 @@ protected:
     return test;
   }
 
+  // Warn about any character entities (\&name;) in the text that we do not know how to print.
+  void _ValidateEntities(const emp::String & text) const {
+    for (const emp::String & entity : FindUnknownEntities(text)) {
+      _Warning("Unknown character entity '\\&", entity, ";' will be printed as written.");
+    }
+  }
+
+  // Check the text that all question types share.
+  void _ValidateText() const {
+    _ValidateEntities(question);
+    _ValidateEntities(alt_question);
+    _ValidateEntities(explanation);
+    _ValidateEntities(hint);
+  }
+
+  // Print the asset lines for this question in QBL format.
+  void _PrintAssetsQBL(std::ostream & os) const {
+    for (const AssetRef & asset : assets) {
+      os << "@ " << asset.given_path;
+      if (asset.alt.size()) os << ' ' << asset.alt;
+      os << '\n';
+    }
+  }
+
+  // Print each asset on its own line in HTML.
+  void _PrintAssetsHTML(std::ostream & os) const {
+    for (const AssetRef & asset : assets) os << "    <p>" << asset.ToHTML() << "</p>\n";
+  }
+
+  void _PrintAssetsLatex(std::ostream & os) const {
+    for (const AssetRef & asset : assets) os << asset.ToLatex();
+  }
+
+  // D2L shows one image in its own Image row; any other assets go at the end of the text.
+  size_t _D2LImageID() const {
+    size_t image_id = 0;
+    while (image_id < assets.size() && !assets[image_id].IsImage()) ++image_id;
+    return image_id;
+  }
+  String _D2LImagePath() const {
+    const size_t image_id = _D2LImageID();
+    return image_id < assets.size() ? assets[image_id].path : "";
+  }
+  String _D2LAssetText() const {
+    String out;
+    const size_t image_id = _D2LImageID();
+    for (size_t i = 0; i < assets.size(); ++i) {
+      if (i != image_id) out.Append("<br>", assets[i].ToHTML());
+    }
+    return out;
+  }
+
 public:
   Question() { }
   Question(size_t id) : id(id) { }       ///< Constructor that specified ID.
@@ -95,6 +170,7 @@ public:
   Question & operator=(Question &&) = default;
 
   size_t GetID() const { return id; }
+  const emp::String & GetSource() const { return source; }
   const emp::String & GetQuestion() const { return question; }
   const emp::String & GetAltQuestion() const { return alt_question; }
   const emp::String & GetExplanation() const { return explanation; }
@@ -107,6 +183,8 @@ public:
 
   void SetFixed() { is_fixed = true; }
   void SetRequired() { is_required = true; }
+  void SetID(size_t in) { id = in; }
+  void SetSource(const emp::String & in) { source = in; }
 
   void AddText(const emp::String & line) {
     // Text with a start symbol would have been directed elsewhere.  Regular text is either a
@@ -142,40 +220,105 @@ public:
     last_edit = Section::EXPLANATION;
   }
 
+  /// Set all of the text for this question at once (rather than line by line).
+  void SetText(const String & in_question, const String & in_alt,
+               const String & in_explanation, const String & in_hint) {
+    question = in_question;
+    alt_question = in_alt;
+    explanation = in_explanation;
+    hint = in_hint;
+    last_edit = Section::OPTIONS;
+  }
+
   void AddTags(String line) {
-    line.Compress();
-    auto tags = line.Slice(" ");
-    for (auto tag : tags) {      
-      if (tag[0] == '#') base_tags.push_back(tag);
-      else if (tag[0] == '^') exclusive_tags.push_back(tag);
-      else if (tag[0] == ':') {
-        _TestError(!tag.Has('='), "Tag '", tag, "' must have an assignment.");
-        String name = tag.Pop('=');
-        _TestError(tag.size() == 0, "Tag '", tag, "' must have value after '='.");
-        config_tags[name] = tag;
-      }
-      else {
-        _Error("Unknown tag type '", tag, "'.");
-      }
+    tags.AddTags(line, [this](auto &&... args){ _Error(args...); });
+  }
+
+  /// Add a single tag that has already been parsed.
+  void AddTag(const String & name, const String & value="") { tags.AddTag(name, value); }
+
+  const TagSet & GetOwnTags() const { return tags; }
+  const emp::vector<emp::Ptr<const TagSet>> & GetSharedTags() const { return shared_tags; }
+
+  /// Attach an asset that has been placed in the bank's AssetStore.
+  void AddAsset(const String & source, const String & given_path, const String & path,
+                const String & alt) {
+    assets.push_back(AssetRef{source, given_path, path, alt});
+  }
+  const emp::vector<AssetRef> & GetAssets() const { return assets; }
+
+  /// Attach a pre-parsed tag block; it is shared by reference rather than copied.
+  void AddSharedTags(emp::Ptr<const TagSet> tag_set) { shared_tags.push_back(tag_set); }
+
+  emp::vector<String> GetBaseTags() const {
+    emp::vector<String> out;
+    for (auto tag_set : shared_tags) emp::Append(out, tag_set->GetBaseTags());
+    emp::Append(out, tags.GetBaseTags());
+    return out;
+  }
+
+  /// Call fun(tag) for each tag this question is exclusive (^) on, shared tags first, reading
+  /// the tag sets in place rather than building a merged list.
+  template <typename FUN_T>
+  void ForEachExclusiveTag(FUN_T && fun) const {
+    for (auto tag_set : shared_tags) {
+      for (const String & tag : tag_set->GetExclusiveTags()) fun(tag);
     }
+    for (const String & tag : tags.GetExclusiveTags()) fun(tag);
   }
 
-  const emp::vector<String> & GetBaseTags() const { return base_tags; }
-  const emp::vector<String> & GetExclusiveTags() const { return exclusive_tags; }
+  bool HasTag(const String & tag) const {
+    if (tags.HasTag(tag)) return true;
+    for (auto tag_set : shared_tags) if (tag_set->HasTag(tag)) return true;
+    return false;
+  }
+
+  /// Hash everything that can affect how this question is rendered.  For a generated question
+  /// this includes its variant (the options chosen, their order, and any alternate wording).
+  uint64_t GetContentHash() const {
+    Hasher hasher;
+    hasher.Add(id);
+    AddContentToHash(hasher);
+    return hasher.Get();
+  }
 
-  bool HasTag(String tag) const {
-    return emp::Has(base_tags, tag) || emp::Has(exclusive_tags, tag) || emp::Has(config_tags, tag);
+  /// Identify this question by its content and the name of its file, but not its ID (which
+  /// is its position in the bank), so that adding or removing other questions does not
+  /// change it.  Manifests use this to find their questions again.
+  uint64_t GetIdentityHash() const {
+    Hasher hasher;
+    hasher.Add(source);
+    AddContentToHash(hasher);
+    return hasher.Get();
   }
 
-  size_t GetAvoid() const { return avoid; }
-  void IncAvoid() { ++avoid; }
-  void DecayAvoid() { if (avoid) avoid--; }
+  void AddContentToHash(Hasher & hasher) const {
+    hasher.Add(question, alt_question, explanation, hint, points, is_required, is_fixed);
+    tags.AddToHash(hasher);
+    hasher.Add(shared_tags.size());
+    for (auto tag_set : shared_tags) tag_set->AddToHash(hasher);
+    AddDetailsToHash(hasher);
+    if (assets.size()) {                // Asset paths include the hash of their contents.
+      hasher.Add(assets.size());
+      for (const AssetRef & asset : assets) hasher.Add(asset.path, asset.alt);
+    }
+  }
 
   // ----- Virtual Function for Specific Question Types -----
 
+  virtual void AddDetailsToHash(Hasher & hasher) const = 0;
+
+  virtual emp::Ptr<Question> Clone() const = 0;
+
+  virtual String GetTypeName() const = 0;   ///< Control command name, e.g. "multiple_choice"
+
   virtual void AddOption(const emp::String & line) = 0;
   virtual void AddOption(emp::String tag, const emp::String & option) = 0;
 
+  /// Access options independently of question type (for saving and restoring questions).
+  virtual emp::vector<OptionData> GetOptionData() const = 0;
+  virtual void AddOptionData(const OptionData & option) = 0;
+
   virtual void Print(std::ostream & os=std::cout) const = 0;
   virtual void PrintD2L(std::ostream & os=std::cout) const = 0;
   virtual void PrintGradeScope(std::ostream & os=std::cout, size_t q_num=0, bool compressed=false) const = 0;
@@ -185,4 +328,9 @@ public:
 
   virtual void Validate() = 0;
   virtual void Generate(emp::Random & random) = 0;
+
+  /// Describe the choices Generate() made for this copy (empty if it was not generated), so
+  /// that ApplyVariant() can repeat them exactly on a fresh copy without a random generator.
+  virtual String GetVariant() const = 0;
+  virtual bool ApplyVariant(String variant) = 0;
 };
@@ -1,15 +1,41 @@
 #pragma once
 
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+
 #include "emp/base/notify.hpp"
 #include "emp/base/Ptr.hpp"
 #include "emp/base/vector.hpp"
+#include "emp/bits/BitVector.hpp"
+#include "emp/datastructs/vector_utils.hpp"
+#include "emp/io/File.hpp"
 #include "emp/math/Random.hpp"
 #include "emp/math/random_utils.hpp"
 #include "emp/tools/String.hpp"
 
+#include "Asset.hpp"
+#include "Decompress.hpp"
+#include "Diagnostics.hpp"
+#include "Embedded.hpp"
+#include "FileReader.hpp"
+#include "OutputFile.hpp"
 #include "Question.hpp"
 #include "Question_MultipleChoice.hpp"
 #include "Question_ShortAnswer.hpp"
+#include "RenderCache.hpp"
+#include "Scheduler.hpp"
+#include "SelectionCache.hpp"
+#include "TagIndex.hpp"
+#include "TagSet.hpp"
+#include "Template.hpp"
+#include "Utf8.hpp"
 
 using emp::String;
 
@@ -27,16 +53,54 @@ private:
     SHORT_ANSWER
   };
   QType question_type = QType::MULTIPLE_CHOICE;
-  String default_tags = "";
+
+  // Tag blocks are parsed once and shared by all of the questions they apply to.
+  std::map<String, emp::Ptr<TagSet>> tag_blocks; ///< All tag blocks, keyed by compressed text.
+  emp::Ptr<const TagSet> default_tags = nullptr; ///< Tags set with /use_tags
+  emp::Ptr<const TagSet> file_tags = nullptr;    ///< Tag block for the rest of the current file.
+  String pending_tags = "";                      ///< Tags seen before any question text.
+
+  // Files are only ever loaded once; an /include of a file already in the bank is skipped.
+  std::set<String> loaded_files;    ///< Canonical paths of all files loaded so far.
+  std::set<String> listed_files;    ///< Canonical paths of files loaded directly (not included).
+  emp::vector<String> include_stack; ///< Canonical paths of files currently being loaded.
+
+  // Each file given to LoadFile (with everything it includes) can be reloaded on its own; see
+  // ReloadFiles().  Question type and /use_tags settings carry over from one listed file into
+  // the next, so those in effect at either end of each are kept too.
+  struct FileUnit {
+    String filename;                ///< File as given to LoadFile.
+    size_t first_q = 0;             ///< Position of its first question in the bank.
+    size_t q_count = 0;             ///< Number of questions from it (and the files it includes).
+    size_t first_source = 0;        ///< Position of its name in source_files.
+    size_t source_count = 0;        ///< Number of files loaded for it (itself and includes).
+    QType start_type = QType::MULTIPLE_CHOICE;
+    QType end_type = QType::MULTIPLE_CHOICE;
+    emp::Ptr<const TagSet> start_tags = nullptr;
+    emp::Ptr<const TagSet> end_tags = nullptr;
+  };
+  emp::vector<FileUnit> file_units;  ///< Every file loaded directly, in order.
+
+  AssetStore asset_store;           ///< Images and attachments used by questions.
+
+  emp::Ptr<RenderCache> render_cache = nullptr; ///< Previously rendered questions (if any).
+  emp::Ptr<FileReader> file_reader = nullptr;   ///< Reads question files ahead of time (if any).
+  emp::Ptr<Scheduler> scheduler = nullptr;      ///< Runs per-question work in parallel (if any).
+  emp::Ptr<SelectionCache> selection_cache = nullptr; ///< Candidate sets for selection (if any).
+  emp::Ptr<TagIndex> tag_index = nullptr;       ///< Questions with each tag (see Validate).
+  emp::Ptr<const TemplateSet> templates = nullptr; ///< Wrappers for each question (if any).
+  String template_title = "";                   ///< Title for {{title}} in question wrappers.
+  String template_base = "";                    ///< Filename for {{base}} in question wrappers.
+
+  // Questions can be handed off (e.g., to a pipeline) as soon as they are fully parsed.
+  std::function<void(emp::Ptr<Question>)> on_question_done;  ///< Called once per finished question.
+  size_t done_count = 0;                                     ///< Questions already handed off.
 
   enum class QStatus {
     UNKNOWN = 0,
     EXCLUDED,
     INCLUDED
   };
-  emp::vector<QStatus> q_status;
-  size_t include_count=0;           // Number of questions selected for inclusion.
-  size_t exclude_count=0;           // Number of questions excluded.
 
   using tag_set_t = emp::vector<String>;
 
@@ -56,16 +120,135 @@ private:
         emp::notify::Error("Unknown Question Type ", GetQuestionType());
       }
       questions.push_back(new_q);
-      if (default_tags.size()) new_q->AddTags(default_tags);
+      if (include_stack.size()) {     // Identify questions by file name, not full path.
+        new_q->SetSource(std::filesystem::path(include_stack.back().str()).filename().string());
+      }
+      if (default_tags) new_q->AddSharedTags(default_tags);
+      if (file_tags) new_q->AddSharedTags(file_tags);
+      if (pending_tags.size()) {       // Tags at the top of this entry belong to this question.
+        new_q->AddTags(pending_tags);
+        pending_tags.clear();
+      }
       start_new = false;
     }
 
     return *questions.back();
   }
+
+  // Print a single question with print_fun, reusing a cached rendering if one is available.
+  // Provide q_num only for formats where the question number appears in the output.
+  template <typename PRINT_FUN>
+  void _PrintCached(std::ostream & os, std::string_view format, size_t id, size_t q_num,
+                    PRINT_FUN && print_fun) const {
+    if (!render_cache) { print_fun(os); return; }
+    const uint64_t key = RenderCache::MakeKey(questions[id]->GetContentHash(), format, q_num);
+    if (render_cache->Lookup(key, os)) return;
+    std::stringstream ss;
+    DiagnosticLog log;
+    log.Capture([&print_fun, &ss](){ print_fun(ss); });
+    // Some checks only happen while rendering (e.g., web output needs exactly one correct
+    // answer), so a rendering that raised any is not cached; it must warn again next time.
+    if (log.IsEmpty()) render_cache->Store(key, ss.str());
+    log.Report();
+    os << ss.str();
+  }
+
+  // Print a question, inside the wrapper template for its format (if there is one).
+  template <typename PRINT_FUN>
+  void _PrintQuestion(std::ostream & os, std::string_view format, size_t id, size_t q_num,
+                      PRINT_FUN && print_fun) const {
+    auto print_body = [&](std::ostream & out){ _PrintCached(out, format, id, q_num, print_fun); };
+    if (!templates) { print_body(os); return; }
+    OutputTemplate::Values values;
+    values.title = template_title.str();
+    values.base = template_base.str();
+    values.q_num = id + 1;
+    values.id = questions[id]->GetID();
+    templates->PrintWrapped(os, format, values, print_body);
+  }
+
+  // Run fun(id) for the position of every question, in parallel when there is a scheduler.
+  // Diagnostics are held for each question and reported in question order afterward.
+  template <typename FUN_T>
+  void _ForEachQuestion(FUN_T && fun) const {
+    if (!scheduler) {
+      for (size_t id = 0; id < questions.size(); ++id) fun(id);
+      return;
+    }
+    emp::vector<DiagnosticLog> logs(questions.size());
+    scheduler->ParallelFor(0, questions.size(), [&fun, &logs](size_t id){
+      logs[id].Capture([&fun, id](){ fun(id); });
+    });
+    for (DiagnosticLog & log : logs) log.Report();
+  }
+
+  // Render each question with print_fun(os, id); questions are rendered in parallel when there
+  // is a scheduler, but always written (and their diagnostics reported) in order.
+  template <typename PRINT_FUN>
+  void _PrintEach(std::ostream & os, PRINT_FUN && print_fun) const {
+    if (!scheduler || scheduler->GetThreadCount() == 1) {
+      for (size_t id = 0; id < questions.size(); ++id) print_fun(os, id);
+      return;
+    }
+    emp::vector<DiagnosticLog> logs(questions.size());
+    auto texts = scheduler->ParallelMap<std::string>(questions.size(),
+      [&print_fun, &logs](size_t id){
+        std::stringstream ss;
+        logs[id].Capture([&print_fun, &ss, id](){ print_fun(ss, id); });
+        return ss.str();
+      });
+    for (DiagnosticLog & log : logs) log.Report();
+    for (const std::string & text : texts) os << text;
+  }
+
+  // Find (or parse) the shared tag block for the provided line of tags.
+  emp::Ptr<const TagSet> _GetTagBlock(String line) {
+    line.Compress();
+    auto & block = tag_blocks[line];
+    if (!block) {
+      block = emp::NewPtr<TagSet>();
+      block->AddTags(line, [this](auto &&... args){
+        emp::notify::Error("In file '", source_files.back(), "': ", args...);
+      });
+    }
+    return block;
+  }
+
+  // Tags in an entry with no question become the tag block for the rest of the file.
+  void _ClosePendingTags() {
+    if (!pending_tags.size()) return;
+    file_tags = _GetTagBlock(pending_tags);
+    if (file_tags->IsEmpty()) file_tags = nullptr;
+    pending_tags.clear();
+  }
 public:
   QuestionBank() { }
+  QuestionBank(const QuestionBank &) = delete;  // Questions are owned; use AddCopies() instead.
   ~QuestionBank() {
     for (auto ptr : questions) ptr.Delete();
+    for (auto & [line, ptr] : tag_blocks) ptr.Delete();
+  }
+
+  /// Remove every question (and the files, tags, and assets they came with) so that the bank
+  /// can be loaded again.  Settings such as the scheduler, caches, and tag index are kept.
+  void Clear() {
+    for (auto ptr : questions) ptr.Delete();
+    for (auto & [line, ptr] : tag_blocks) ptr.Delete();
+    questions.clear();
+    tag_blocks.clear();
+    source_files.clear();
+    loaded_files.clear();
+    listed_files.clear();
+    include_stack.clear();
+    file_units.clear();
+    start_new = true;
+    question_type = QType::MULTIPLE_CHOICE;
+    default_tags = nullptr;
+    file_tags = nullptr;
+    pending_tags.clear();
+    asset_store.Clear();
+    done_count = 0;
+    if (selection_cache) selection_cache->SetSnapshot(0);   // Positions are no longer valid.
   }
 
   String GetQuestionType() const {
@@ -78,15 +261,286 @@ public:
     return "Invalid";
   }
 
-  void NewEntry() { start_new = true; }
+  size_t GetSize() const { return questions.size(); }
+  const emp::vector<String> & GetSourceFiles() const { return source_files; }
+
+  void NewEntry() {
+    if (start_new) _ClosePendingTags();
+    start_new = true;
+
+    // No line after this can change an existing question, so they are all finished.
+    if (on_question_done) {
+      while (done_count < questions.size()) on_question_done(questions[done_count++]);
+    }
+  }
+
+  /// Provide a function to call with each question as soon as it has been fully loaded.
+  void SetOnQuestionDone(std::function<void(emp::Ptr<Question>)> fun) {
+    on_question_done = fun;
+    done_count = questions.size();
+  }
 
   void NewFile(String filename) { source_files.push_back(filename), start_new = true; }
 
+  /// Load all of the questions from the provided file.  Relative paths are taken from the
+  /// directory of the file currently being loaded (if any).  Returns false if not loaded.
+  bool LoadFile(String filename) {
+    if (include_stack.size()) return _LoadFile(filename);
+    FileUnit unit{filename, questions.size(), 0, source_files.size(), 0,
+                  question_type, question_type, default_tags, default_tags};
+    if (!_LoadFile(filename)) return false;
+    unit.q_count = questions.size() - unit.first_q;
+    unit.source_count = source_files.size() - unit.first_source;
+    unit.end_type = question_type;
+    unit.end_tags = default_tags;
+    file_units.push_back(unit);
+    return true;
+  }
+
+  /// Reload only the listed files that are (or include) one of the changed files, named as in
+  /// GetSourceFiles(), replacing their questions in place.  The tag index is only updated for
+  /// the questions added, removed, or changed.  Returns false if the bank must be cleared and
+  /// loaded again instead: a changed file is not a question file, or the edit could affect
+  /// other files (by changing which files are included or the settings left at the end).
+  bool ReloadFiles(const std::set<String> & changed) {
+    std::set<size_t> unit_ids;
+    std::set<String> found;
+    for (size_t unit_id = 0; unit_id < file_units.size(); ++unit_id) {
+      const FileUnit & unit = file_units[unit_id];
+      for (size_t pos = unit.first_source; pos < unit.first_source + unit.source_count; ++pos) {
+        if (!changed.contains(source_files[pos])) continue;
+        unit_ids.insert(unit_id);
+        found.insert(source_files[pos]);
+      }
+    }
+    if (found.size() < changed.size()) return false;
+    for (size_t unit_id : unit_ids) {
+      if (!_ReloadUnit(unit_id)) return false;
+    }
+    if (selection_cache) selection_cache->SetSnapshot(GetSnapshotHash());
+    return true;
+  }
+
+private:
+  // Reparse one listed file, starting from the settings it started from before, and splice its
+  // new questions in place of the old ones.  Returns false if files after it may need to be
+  // reparsed too (the bank is still left consistent).
+  bool _ReloadUnit(size_t unit_id) {
+    FileUnit & unit = file_units[unit_id];
+    auto q_begin = questions.begin() + static_cast<std::ptrdiff_t>(unit.first_q);
+    auto q_end = q_begin + static_cast<std::ptrdiff_t>(unit.q_count);
+    emp::vector<emp::Ptr<Question>> old_questions(q_begin, q_end);
+    emp::vector<emp::Ptr<Question>> q_tail(q_end, questions.end());
+    questions.resize(unit.first_q);
+    auto src_begin = source_files.begin() + static_cast<std::ptrdiff_t>(unit.first_source);
+    auto src_end = src_begin + static_cast<std::ptrdiff_t>(unit.source_count);
+    const emp::vector<String> old_sources(src_begin, src_end);
+    const emp::vector<String> src_tail(src_end, source_files.end());
+    source_files.resize(unit.first_source);
+
+    for (const String & filename : old_sources) {
+      loaded_files.erase(CanonicalPath(std::filesystem::path(filename.str())));
+    }
+    listed_files.erase(CanonicalPath(std::filesystem::path(unit.filename.str())));
+    question_type = unit.start_type;
+    default_tags = unit.start_tags;
+    file_tags = nullptr;
+    pending_tags.clear();
+    start_new = true;
+    const bool loaded = _LoadFile(unit.filename);
+
+    const size_t new_count = questions.size() - unit.first_q;
+    const size_t new_sources = source_files.size() - unit.first_source;
+    const bool same_scope = loaded && question_type == unit.end_type &&
+      default_tags == unit.end_tags &&
+      std::equal(source_files.begin() + static_cast<std::ptrdiff_t>(unit.first_source),
+                 source_files.end(), old_sources.begin(), old_sources.end());
+    for (size_t pos = unit.first_q; pos < questions.size(); ++pos) questions[pos]->Validate();
+    questions.insert(questions.end(), q_tail.begin(), q_tail.end());
+    source_files.insert(source_files.end(), src_tail.begin(), src_tail.end());
+
+    // Questions are numbered by position, so any after these move to new IDs.
+    if (new_count != unit.q_count) {
+      for (size_t pos = unit.first_q + new_count; pos < questions.size(); ++pos) {
+        questions[pos]->SetID(pos + 1);
+      }
+    }
+    for (size_t id = unit_id + 1; id < file_units.size(); ++id) {
+      file_units[id].first_q = file_units[id].first_q + new_count - unit.q_count;
+      file_units[id].first_source = file_units[id].first_source + new_sources - unit.source_count;
+    }
+    if (tag_index) tag_index->Splice(questions, unit.first_q, unit.q_count, new_count);
+    for (auto q : old_questions) q.Delete();
+    unit.q_count = new_count;
+    unit.source_count = new_sources;
+    question_type = file_units.back().end_type;   // Restore the settings from the last file.
+    default_tags = file_units.back().end_tags;
+    return same_scope;
+  }
+
+  bool _LoadFile(String filename) {
+    std::filesystem::path path(filename.str());
+    if (include_stack.size() && path.is_relative()) {
+      path = std::filesystem::path(include_stack.back().str()).parent_path() / path;
+    }
+    const String canon_path = CanonicalPath(path);
+
+    // Make sure we are not in an include cycle.
+    if (emp::Has(include_stack, canon_path)) {
+      emp::notify::Error("Include cycle detected: '", canon_path, "' includes itself via ",
+                         emp::MakeLiteral(include_stack), ".");
+      return false;
+    }
+
+    // Only parse each file once per run, no matter how many places include it.  Naming the
+    // same file twice directly (not by /include) is likely a mistake, so warn about that.
+    if (include_stack.empty() && !listed_files.insert(canon_path).second) {
+      emp::notify::Warning("Question file '", filename, "' was given more than once.");
+    }
+    if (loaded_files.contains(canon_path)) return false;
+    loaded_files.insert(canon_path);
+
+    // Use the contents from the file reader if it has them; otherwise read the file here.
+    std::string content;
+    const bool have_content = file_reader && file_reader->Take(canon_path, content);
+    if (!have_content && !std::filesystem::exists(path)) {
+      emp::notify::Error("Unable to open question file '", path.string(), "'.");
+      return false;
+    }
+
+    NewFile(path.string());   // Track that we are loading from a new file.
+
+    // Tag blocks only last until the end of the file they are declared in.
+    const auto prev_file_tags = file_tags;
+    file_tags = nullptr;
+
+    include_stack.push_back(canon_path);
+    auto process_line = [this, &path](const emp::String & line) {
+      if (const size_t bad_pos = utf8::FindInvalid(line.str()); bad_pos != std::string_view::npos) {
+        emp::notify::Error("Invalid UTF-8 in file '", path.string(), "' (byte ", bad_pos,
+                           " of line): ", line);
+      }
+      if (line.OnlyWhitespace()) NewEntry();
+      else AddLine(line);
+    };
+
+    // Compressed files are decoded on another thread and parsed as their lines arrive.
+    using Codec = DecompressStream::Codec;
+    const Codec codec = have_content ? DecompressStream::DetectCodec(content)
+                                     : DecompressStream::DetectFileCodec(path.string());
+    if (codec != Codec::NONE) {
+      emp::Ptr<DecompressStream> stream = have_content
+        ? emp::NewPtr<DecompressStream>(codec, std::move(content))
+        : emp::NewPtr<DecompressStream>(codec, path.string());
+      emp::String line;
+      while (stream->GetLine(line)) {
+        if (!line.HasPrefix("%")) process_line(line);   // Skip comment lines.
+      }
+      if (stream->GetError().size()) {
+        emp::notify::Error("Unable to decompress '", path.string(), "': ", stream->GetError());
+      }
+      stream.Delete();
+    }
+    else {
+      emp::File file;
+      if (have_content) {
+        std::istringstream content_stream(content);
+        file.Load(content_stream);
+      }
+      else file.Load(path.string());
+      file.RemoveIfBegins("%");  // Remove all comment lines.
+      for (const emp::String & line : file) process_line(line);
+    }
+    include_stack.pop_back();
+    NewEntry();                // Never continue a question across files.
+    pending_tags.clear();      // Tags at the very end of a file have nothing to apply to.
+    file_tags = prev_file_tags;
+
+    return true;
+  }
+
+public:
+
+  /// Set up questions from a bank compiled into the executable (see Embedded.hpp); nothing
+  /// needs to be parsed, beyond creating the tag blocks and questions themselves.
+  void LoadEmbedded(const EmbeddedBank & bank) {
+    for (std::string_view filename : bank.source_files) NewFile(String(std::string(filename)));
+
+    emp::vector<emp::Ptr<const TagSet>> blocks;
+    for (const EmbeddedTagBlock & block : bank.blocks) {
+      String key = "embedded";   // Keep embedded blocks apart from any parsed later.
+      for (size_t i = 0; i < block.tag_count; ++i) {
+        const EmbeddedTag & tag = bank.tags[block.tag_start + i];
+        key.Append(' ', std::string(tag.name), tag.value.size() ? "=" : "", std::string(tag.value));
+      }
+      auto & tag_set = tag_blocks[key];
+      if (!tag_set) {
+        tag_set = emp::NewPtr<TagSet>();
+        for (size_t i = 0; i < block.tag_count; ++i) {
+          const EmbeddedTag & tag = bank.tags[block.tag_start + i];
+          tag_set->AddTag(String(std::string(tag.name)), String(std::string(tag.value)));
+        }
+      }
+      blocks.push_back(tag_set);
+    }
+
+    for (const EmbeddedQuestion & eq : bank.questions) {
+      emp::Ptr<Question> q = nullptr;
+      if (eq.type == "multiple_choice") q = emp::NewPtr<Question_MultipleChoice>(eq.id);
+      else if (eq.type == "short_answer") q = emp::NewPtr<Question_ShortAnswer>(eq.id);
+      else {
+        emp::notify::Error("Unknown embedded question type '", std::string(eq.type), "'.");
+        continue;
+      }
+      q->SetText(String(std::string(eq.question)), String(std::string(eq.alt_question)),
+                 String(std::string(eq.explanation)), String(std::string(eq.hint)));
+      if (eq.is_required) q->SetRequired();
+      if (eq.is_fixed) q->SetFixed();
+      q->SetSource(String(std::string(eq.source)));
+      for (size_t i = 0; i < eq.shared_count; ++i) {
+        q->AddSharedTags(blocks[bank.shared_blocks[eq.shared_start + i]]);
+      }
+      for (const String & tag : blocks[eq.own_block]->GetBaseTags()) q->AddTag(tag);
+      for (const String & tag : blocks[eq.own_block]->GetExclusiveTags()) q->AddTag(tag);
+      for (const auto & [name, value] : blocks[eq.own_block]->GetConfigTags()) q->AddTag(name, value);
+      for (size_t i = 0; i < eq.option_count; ++i) {
+        const EmbeddedOption & opt = bank.options[eq.option_start + i];
+        q->AddOptionData(OptionData{String(std::string(opt.text)), opt.is_correct, opt.is_fixed,
+                                    opt.is_required});
+      }
+      questions.push_back(q);
+    }
+    start_new = true;
+    NewEntry();     // Hand off the finished questions, if anyone is waiting for them.
+  }
+
+  /// Load another file from within the current one.  Any control settings changed in the
+  /// included file (question type, default tags) are restored when it finishes.
+  void IncludeFile(String filename) {
+    if (filename.empty()) {
+      emp::notify::Error("The /include command requires a filename.");
+      return;
+    }
+    // The included file starts from the default settings (it is only parsed once, so its
+    // meaning must not depend on which file includes it first), and ours are restored after.
+    const QType prev_type = question_type;
+    const auto prev_tags = default_tags;
+    NewEntry();
+    question_type = QType::MULTIPLE_CHOICE;
+    default_tags = nullptr;
+    LoadFile(filename);
+    question_type = prev_type;
+    default_tags = prev_tags;
+  }
+
   /// Process the provided line to change behavior of QBL.
   void ProcessControl(String line) {
     String command = line.PopWord();
-    if (command == "/use_tags") {              // Add provided tags to all subsequent questions
-      default_tags = line;
+    if (command == "/include") {               // Load questions from another file here.
+      IncludeFile(line);
+    }
+    else if (command == "/use_tags") {         // Add provided tags to all subsequent questions
+      default_tags = line.OnlyWhitespace() ? nullptr : _GetTagBlock(line);
     }
     else if (command == "/multiple_choice") {  // Change question type to multiple choice
       question_type = QType::MULTIPLE_CHOICE;
@@ -107,6 +561,18 @@ public:
     }
   }
 
+  /// Attach an asset to the current question; relative paths are taken from the directory of
+  /// the file currently being loaded.
+  void AddAsset(const String & filename, const String & alt) {
+    std::filesystem::path path(filename.str());
+    if (include_stack.size() && path.is_relative()) {
+      path = std::filesystem::path(include_stack.back().str()).parent_path() / path;
+    }
+    const String canon_path = CanonicalPath(path);
+    const String out_path = asset_store.Add(canon_path);
+    if (out_path.size()) CurQ().AddAsset(canon_path, filename, out_path, alt);
+  }
+
   void AddLine(String line) {
     emp::String tag;
 
@@ -125,7 +591,20 @@ public:
     case '#':                         // Regular question tag
     case '^':                         // "Exclusive" question tag
     case ':':                         // Option tag
-      CurQ().AddTags(line);
+      line.Compress();
+      if (line == "#") {              // A lone '#' clears the current tag block.
+        file_tags = nullptr;
+        pending_tags.clear();
+      }
+      else if (start_new) pending_tags.Append(' ', line); // May be a block; wait to find out.
+      else CurQ().AddTags(line);
+      break;
+    case '@':                         // Asset (image or attachment), then its description
+      line.erase(line.begin());
+      line.TrimWhitespace();
+      tag = line.PopWord();
+      if (tag.empty()) emp::notify::Error("In file '", source_files.back(), "': '@' needs a filename.");
+      else AddAsset(tag, line.TrimWhitespace());
       break;
     case '!':                         // Alternative question option (negated)
       CurQ().AddAltQuestion(line);
@@ -159,48 +638,123 @@ public:
               });
   }
 
+  /// Validate every question; the bank is then ready for selection, so any tag index is
+  /// rebuilt and any selection cache is moved to this snapshot of it.
   void Validate() {
-    for (auto & q : questions) q->Validate();
+    _ForEachQuestion([this](size_t id){ questions[id]->Validate(); });
+    if (tag_index) tag_index->Build(questions);
+    if (selection_cache) selection_cache->SetSnapshot(GetSnapshotHash());
+  }
+
+  // Working state while choosing questions for an exam.  It is kept apart from the questions
+  // themselves so that selection never modifies the bank, and many selections can share it.
+  struct Selection {
+    emp::vector<QStatus> q_status;  // Decision made for each question in the bank.
+    emp::vector<size_t> avoid;      // How many times should we skip each question before picking it?
+    size_t include_count=0;         // Number of questions selected for inclusion.
+    size_t exclude_count=0;         // Number of questions excluded.
+
+    Selection(size_t num_questions)
+      : q_status(num_questions, QStatus::UNKNOWN), avoid(num_questions, 0) { }
+  };
+
+private:
+  Selection selection{0};         ///< How this exam's questions were chosen (for debug output).
+
+public:
+  Selection & GetSelection() { return selection; }
+  const Selection & GetSelection() const { return selection; }
+
+  // Call fun(pos) for each position set in bits, in order.
+  template <typename FUN_T>
+  static void _ForEachPos(const emp::BitVector & bits, FUN_T && fun) {
+    for (int pos = bits.FindOne(); pos >= 0; pos = bits.FindOne(static_cast<size_t>(pos) + 1)) {
+      fun(static_cast<size_t>(pos));
+    }
+  }
+
+  // Positions of the questions with the provided tag.
+  emp::BitVector _GetTagMatches(const String & tag) const {
+    if (tag_index) return tag_index->GetMatches(tag);
+    emp::BitVector bits(questions.size());
+    for (size_t i = 0; i < questions.size(); ++i) if (questions[i]->HasTag(tag)) bits.Set(i);
+    return bits;
+  }
+
+  // Positions of the questions exclusive (^) on the provided tag.
+  emp::BitVector _GetGroup(const String & tag) const {
+    if (tag_index) return tag_index->GetGroup(tag);
+    emp::BitVector bits(questions.size());
+    for (size_t i = 0; i < questions.size(); ++i) {
+      questions[i]->ForEachExclusiveTag([&](const String & q_tag){
+        if (q_tag == tag) bits.Set(i);
+      });
+    }
+    return bits;
+  }
+
+  // Every tag that some question is exclusive (^) on.
+  tag_set_t _GetGroupTags() const {
+    if (tag_index) return tag_index->GetGroupTags();
+    std::set<String> tags;
+    for (auto q : questions) q->ForEachExclusiveTag([&](const String & tag){ tags.insert(tag); });
+    return tag_set_t(tags.begin(), tags.end());
+  }
+
+  // Positions of the questions ruled out by a filter: those with any of the exclude tags, or
+  // missing any of the require tags.
+  emp::BitVector _GetFilteredOut(const tag_set_t & exclude_tags,
+                                 const tag_set_t & require_tags) const {
+    const tag_set_t exclude = SelectionCache::Normalize(exclude_tags);
+    const tag_set_t require = SelectionCache::Normalize(require_tags);
+    auto compute = [&](){
+      emp::BitVector bits(questions.size());
+      for (const String & tag : exclude) bits |= _GetTagMatches(tag);
+      for (const String & tag : require) bits |= ~_GetTagMatches(tag);
+      return bits;
+    };
+    if (!selection_cache) return compute();
+    Hasher hasher;
+    hasher.Add("filter");
+    SelectionCache::AddTags(hasher, exclude);
+    SelectionCache::AddTags(hasher, require);
+    return selection_cache->GetCandidates(hasher.Get(), compute);
   }
 
   // Exclude the specified question.  Report any problems.
-  void Generate_ExcludeQuestion(size_t id, String reason) {
-    emp::notify::TestError(q_status[id] == QStatus::INCLUDED,
+  void Generate_ExcludeQuestion(Selection & sel, size_t id, String reason) const {
+    emp::notify::TestError(sel.q_status[id] == QStatus::INCLUDED,
       "Question ", id, " being excluded (", reason, "), but already included.");
-    if (q_status[id] == QStatus::UNKNOWN) {
-      q_status[id] = QStatus::EXCLUDED;
-      exclude_count++;
+    if (sel.q_status[id] == QStatus::UNKNOWN) {
+      sel.q_status[id] = QStatus::EXCLUDED;
+      sel.exclude_count++;
     }
   }
 
   // Include the specified question.  Report any problems.
-  void Generate_IncludeQuestion(size_t id, String reason) {
+  void Generate_IncludeQuestion(Selection & sel, size_t id, String reason) const {
     // If a question should be avoided, reduce the avoid count and defer selecting it for now.
-    if (questions[id]->GetAvoid()) {
-      questions[id]->DecayAvoid();
+    if (sel.avoid[id]) {
+      sel.avoid[id]--;
       return;
     }
 
-    emp::notify::TestError(q_status[id] == QStatus::EXCLUDED,
+    emp::notify::TestError(sel.q_status[id] == QStatus::EXCLUDED,
       "Question ", id, " being included (", reason, "), but already excluded.");
-    if (q_status[id] == QStatus::INCLUDED) return; // Already included.
+    if (sel.q_status[id] == QStatus::INCLUDED) return; // Already included.
 
     // If there are any exclusive tags, honor them.
-    const auto & exclude_tags = questions[id]->GetExclusiveTags();
-    for (const auto & tag : exclude_tags) {
-      for (size_t i = 0; i < questions.size(); ++i) {
-        if (i == id) continue;
-        if (questions[i]->HasTag(tag)) {
-          Generate_ExcludeQuestion(i, MakeString("Conflict with tag '", tag, "'"));
-        }
-      }
-    }
+    questions[id]->ForEachExclusiveTag([&](const String & tag){
+      _ForEachPos(_GetTagMatches(tag), [&](size_t i){
+        if (i != id) Generate_ExcludeQuestion(sel, i, MakeString("Conflict with tag '", tag, "'"));
+      });
+    });
 
-    q_status[id] = QStatus::INCLUDED;
-    include_count++;
+    sel.q_status[id] = QStatus::INCLUDED;
+    sel.include_count++;
   }
 
-  void Generate_SetupAvoids(const emp::vector<String> & avoid_files) {
+  void Generate_SetupAvoids(Selection & sel, const emp::vector<String> & avoid_files) const {
     for (const String & filename : avoid_files) {
       std::ifstream file(filename);
       emp::notify::TestError(!file, "Unable to open avoid file '", filename, "'. Skipping.");
@@ -213,50 +767,49 @@ public:
           continue;
         }
         emp::notify::TestError(id != questions[index]->GetID(), "mismatched ID; ", id, " != ", questions[index]->GetID());
-        questions[index]->IncAvoid();
+        sel.avoid[index]++;
       }
     }
   }
 
   // Scan through all of the questions and remove those that either have an excluded tag or don't have a required tag.
-  void Generate_DoExcludes(const tag_set_t & exclude_tags, const tag_set_t & require_tags) {
-    for (size_t i = 0; i < questions.size(); ++i) {
-      for (const auto & tag : exclude_tags) {
-        if (questions[i]->HasTag(tag)) Generate_ExcludeQuestion(i, "has exclude tag");
-      }
-      for (const auto & tag : require_tags) {
-        if (!questions[i]->HasTag(tag)) Generate_ExcludeQuestion(i, "doesn't have required tag");
-      }
-    }
+  void Generate_DoExcludes(Selection & sel, const tag_set_t & exclude_tags,
+                           const tag_set_t & require_tags) const {
+    _ForEachPos(_GetFilteredOut(exclude_tags, require_tags), [&](size_t i){
+      Generate_ExcludeQuestion(sel, i, "has exclude tag or doesn't have required tag");
+    });
   }
 
   // Scan through all of the questions and included the ones we are required to.
-  void Generate_DoIncludes(const tag_set_t & include_tags) {
+  void Generate_DoIncludes(Selection & sel, const tag_set_t & include_tags) const {
     // Handle include tags.
+    emp::vector<emp::BitVector> include_matches;
+    for (const auto & tag : include_tags) include_matches.push_back(_GetTagMatches(tag));
     for (size_t i = 0; i < questions.size(); ++i) {
-      if (questions[i]->IsRequired()) Generate_IncludeQuestion(i, "marked required");
-      for (const auto & tag : include_tags) {
-        if (questions[i]->HasTag(tag)) Generate_IncludeQuestion(i, "has include tag");
+      if (questions[i]->IsRequired()) Generate_IncludeQuestion(sel, i, "marked required");
+      for (const auto & matches : include_matches) {
+        if (matches.Get(i)) Generate_IncludeQuestion(sel, i, "has include tag");
       }
     }
   }
 
-  void Generate_DoSamples(emp::Random & random, const tag_set_t & sample_tags) {
+  void Generate_DoSamples(Selection & sel, emp::Random & random,
+                          const tag_set_t & sample_tags) const {
     for (const String & tag : sample_tags) {
       emp::vector<size_t> tag_ids; // Question IDs to choose from with this tag.
       int sample_count = 0;
-      for (size_t id=0; id < questions.size(); ++id) {
-        // Skip questions that don't have the tag or are already excluded.
-        if (!questions[id]->HasTag(tag) || q_status[id] == QStatus::EXCLUDED) continue;
+      _ForEachPos(_GetTagMatches(tag), [&](size_t id){
+        // Skip questions that are already excluded.
+        if (sel.q_status[id] == QStatus::EXCLUDED) return;
 
         // If a question with the tag is already included, we are done!
-        if (q_status[id] == QStatus::INCLUDED) {
+        if (sel.q_status[id] == QStatus::INCLUDED) {
           sample_count += 1;
-          continue;
+          return;
         }
 
         tag_ids.push_back(id); // Track this question as one to possibly add.
-      }
+      });
       if (sample_count == std::count(sample_tags.begin(), sample_tags.end(), tag)) continue;
 
       if (tag_ids.size() == 0) {
@@ -265,91 +818,373 @@ public:
       }
 
       size_t sample_id = emp::SelectRandom(random, tag_ids);
-      Generate_IncludeQuestion(sample_id, "sampled for tag");
+      Generate_IncludeQuestion(sel, sample_id, "sampled for tag");
     }
   }
 
-  // Remove all of the questions that we are not going to use.
-  void Generate_PurgeUnused() {
-    for (size_t i = questions.size()-1; i < questions.size(); --i) {
-      if (q_status[i] != QStatus::INCLUDED) {
-        questions[i].Delete();
-        questions.erase(questions.begin() + i);
-      }
-    }
-  }
-
-  void Generate(size_t count, emp::Random & random, const tag_set_t & include_tags,
-                const tag_set_t & exclude_tags, const tag_set_t & require_tags,
-                const tag_set_t & sample_tags, const emp::vector<String> & avoid_files) {
+  /// Choose which questions to use for an exam; the bank itself is not modified, so any
+  /// number of selections can run at once.  Returns the positions of the chosen questions;
+  /// the final selection state is moved into result, if provided.
+  emp::vector<size_t> Select(size_t count, emp::Random & random, const tag_set_t & include_tags,
+                             const tag_set_t & exclude_tags, const tag_set_t & require_tags,
+                             const tag_set_t & sample_tags,
+                             const emp::vector<String> & avoid_files,
+                             emp::Ptr<Selection> result=nullptr) const {
     emp::notify::TestWarning(count > questions.size(), "Requesting more questions (", count,
       ") than available in Question Bank (", questions.size(), ")");
 
     // Setup analysis for picking questions.
-    q_status.resize(questions.size(), QStatus::UNKNOWN);
-    include_count = 0;
-    exclude_count = 0;
+    Selection sel(questions.size());
 
-    Generate_SetupAvoids(avoid_files);
-    Generate_DoExcludes(exclude_tags, require_tags);
-    Generate_DoIncludes(include_tags);
-    Generate_DoSamples(random, sample_tags);
+    Generate_SetupAvoids(sel, avoid_files);
+    Generate_DoExcludes(sel, exclude_tags, require_tags);
+    Generate_DoIncludes(sel, include_tags);
+    Generate_DoSamples(sel, random, sample_tags);
 
     // Pick them randomly from here to fill in the rest;
     // loop as long as we need questions and there are some left.
-    while (include_count < count && include_count + exclude_count < questions.size()) {
+    while (sel.include_count < count && sel.include_count + sel.exclude_count < questions.size()) {
       size_t pick = random.GetUInt(questions.size());
-      if (q_status[pick] != QStatus::UNKNOWN) continue;
-      Generate_IncludeQuestion(pick, "random pick");
+      if (sel.q_status[pick] != QStatus::UNKNOWN) continue;
+      Generate_IncludeQuestion(sel, pick, "random pick");
     }
 
-    emp::notify::TestWarning(include_count < count,
-      "Unable to select ", count, " questions given exclusions; only ", include_count, " used.");
-
-    // Remove any questions that were not picked during generation
-    Generate_PurgeUnused();
+    emp::notify::TestWarning(sel.include_count < count,
+      "Unable to select ", count, " questions given exclusions; only ", sel.include_count, " used.");
 
-    // Go through each of the kept questions an limit the choices.
-    for (auto q : questions) q->Generate(random);
+    emp::vector<size_t> out_ids;
+    for (size_t i = 0; i < questions.size(); ++i) {
+      if (sel.q_status[i] == QStatus::INCLUDED) out_ids.push_back(i);
+    }
+    if (result) *result = std::move(sel);
+    return out_ids;
   }
 
-  void Print(std::ostream & os=std::cout) const {
+  /// Choose a replacement for question exam_ids[veto_index] of an existing exam (given as
+  /// the bank positions of its questions), under the constraints it was originally selected
+  /// with.  Questions in the exam or rejected are never chosen, nor any that conflict with the
+  /// rest of the exam through an exclusive (^) tag.  Preference goes to questions that restore
+  /// any sample tags lost with the vetoed question, then to those worth the same points, then
+  /// to those not being avoided.  Returns GetSize() if no question fits.
+  size_t SelectReplacement(const emp::vector<size_t> & exam_ids, size_t veto_index,
+                           const emp::vector<size_t> & rejected, emp::Random & random,
+                           const tag_set_t & exclude_tags, const tag_set_t & require_tags,
+                           const tag_set_t & sample_tags,
+                           const emp::vector<String> & avoid_files) const {
+    Selection sel(questions.size());
+    Generate_SetupAvoids(sel, avoid_files);
+    Generate_DoExcludes(sel, exclude_tags, require_tags);
+    for (size_t id : rejected) sel.q_status[id] = QStatus::EXCLUDED;
+    emp::vector<size_t> kept_ids;
+    for (size_t i = 0; i < exam_ids.size(); ++i) {
+      sel.q_status[exam_ids[i]] = QStatus::EXCLUDED;
+      if (i != veto_index) kept_ids.push_back(exam_ids[i]);
+    }
+
+    // Sample tags that the remaining questions no longer cover often enough.
+    const Question & vetoed = *questions[exam_ids[veto_index]];
+    tag_set_t lost_tags;
+    for (const String & tag : sample_tags) {
+      if (!vetoed.HasTag(tag) || emp::Has(lost_tags, tag)) continue;
+      const auto kept_count = std::count_if(kept_ids.begin(), kept_ids.end(),
+        [this, &tag](size_t id){ return questions[id]->HasTag(tag); });
+      if (kept_count < std::count(sample_tags.begin(), sample_tags.end(), tag)) {
+        lost_tags.push_back(tag);
+      }
+    }
+
+    // Questions that conflict with the rest of the exam through an exclusive tag: those with a
+    // tag that a kept question is exclusive on, and those exclusive on a tag a kept one has.
+    emp::BitVector conflicts(questions.size());
+    for (size_t kept_id : kept_ids) {
+      questions[kept_id]->ForEachExclusiveTag([&](const String & tag){
+        conflicts |= _GetTagMatches(tag);
+      });
+    }
+    for (const String & tag : _GetGroupTags()) {
+      const emp::BitVector matches = _GetTagMatches(tag);
+      if (std::any_of(kept_ids.begin(), kept_ids.end(), [&](size_t id){ return matches.Get(id); })) {
+        conflicts |= _GetGroup(tag);
+      }
+    }
+
+    emp::vector<size_t> best_ids;
+    size_t best_score = 0;
     for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->Print(os);
+      if (sel.q_status[id] != QStatus::UNKNOWN || conflicts.Get(id)) continue;
+      const Question & q = *questions[id];
+
+      size_t score = 0;
+      for (const String & tag : lost_tags) if (q.HasTag(tag)) score += 4;
+      if (q.GetPoints() == vetoed.GetPoints()) score += 2;
+      if (sel.avoid[id] == 0) score += 1;
+      if (best_ids.empty() || score > best_score) { best_ids.clear(); best_score = score; }
+      if (score == best_score) best_ids.push_back(id);
     }
+    if (best_ids.empty()) return questions.size();
+    return best_ids[random.GetUInt(best_ids.size())];
   }
 
-  void PrintD2L(std::ostream & os=std::cout) const {
-    for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->PrintD2L(os);
+  /// Add copies of questions (at the provided positions) from another bank into this one.
+  void AddCopies(const QuestionBank & bank, const emp::vector<size_t> & ids) {
+    for (size_t id : ids) questions.push_back(bank.questions[id]->Clone());
+    start_new = true;
+  }
+
+  /// Add copies of all of the questions from another bank into this one.
+  void AddCopies(const QuestionBank & bank) {
+    for (auto q : bank.questions) questions.push_back(q->Clone());
+    start_new = true;
+  }
+
+  /// Go through each of the questions and generate the variant to use (limit the choices,
+  /// shuffle the options, and possibly switch to the alternate wording).  Each question gets
+  /// its own seed (from one draw of `random` and its ID), so the result does not depend on
+  /// the order questions are generated in, or how many threads are used.
+  void GenerateVariants(emp::Random & random) {
+    const uint32_t base_seed = random.GetUInt();
+    _ForEachQuestion([this, base_seed](size_t id){
+      const uint64_t seed = HashValues(base_seed, questions[id]->GetID());
+      emp::Random question_random(static_cast<int>(1 + seed % (INT_MAX - 1)));
+      questions[id]->Generate(question_random);
+    });
+  }
+
+  /// Replace the question at the provided position with a copy of one from another bank, and
+  /// generate its variant.
+  void ReplaceQuestion(size_t pos, const QuestionBank & bank, size_t bank_pos,
+                       emp::Random & random) {
+    questions[pos].Delete();
+    questions[pos] = bank.questions[bank_pos]->Clone();
+    questions[pos]->Generate(random);
+  }
+
+  /// Repeat the variant recorded for the question at the provided position (see
+  /// Question::GetVariant); returns false if the variant does not fit the question.
+  bool ApplyVariant(size_t pos, const String & variant) {
+    return questions[pos]->ApplyVariant(variant);
+  }
+
+  /// Change the ID of the question at the provided position (e.g., back to the ID it had when
+  /// an exam was first built, since IDs shift as questions are added to the bank).
+  void SetID(size_t pos, size_t id) { questions[pos]->SetID(id); }
+
+  const Question & GetQuestionAt(size_t pos) const { return *questions[pos]; }
+
+  /// Every regular (#) tag used by any question, in sorted order.
+  emp::vector<String> GetAllTags() const {
+    std::set<String> tags;
+    for (auto q : questions) {
+      for (const String & tag : q->GetBaseTags()) tags.insert(tag);
     }
+    return emp::vector<String>(tags.begin(), tags.end());
   }
 
-  void PrintGradeScope(std::ostream & os=std::cout, bool compressed = false) const {
-    for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->PrintGradeScope(os, id+1, compressed);
+  AssetStore & GetAssetStore() { return asset_store; }
+  const AssetStore & GetAssetStore() const { return asset_store; }
+
+  /// Output paths of every asset used by the questions in this bank.
+  emp::vector<String> GetAssetPaths() const {
+    emp::vector<String> paths;
+    for (auto q : questions) {
+      for (const AssetRef & asset : q->GetAssets()) paths.push_back(asset.path);
     }
+    return paths;
   }
 
-  void PrintHTML(std::ostream & os=std::cout) const {
-    for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->PrintHTML(os, id+1);
+  /// Find the position of the question with the provided ID; returns GetSize() if not found.
+  size_t FindID(size_t id) const {
+    if (id && id <= questions.size() && questions[id-1]->GetID() == id) return id-1;
+    for (size_t pos = 0; pos < questions.size(); ++pos) {
+      if (questions[pos]->GetID() == id) return pos;
     }
+    return questions.size();
   }
 
-  void PrintJS(std::ostream & os=std::cout) const {
-    for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->PrintJS(os);
+  /// Find the positions of the questions with the provided identities (see
+  /// Question::GetIdentityHash), in order; GetSize() marks any that are not in the bank.
+  /// Identical questions from the same file are matched in order, one position each.
+  emp::vector<size_t> FindIdentities(const emp::vector<uint64_t> & identities) const {
+    std::unordered_map<uint64_t, emp::vector<size_t>> positions;
+    for (size_t pos = questions.size(); pos-- > 0;) {
+      positions[questions[pos]->GetIdentityHash()].push_back(pos);
+    }
+    emp::vector<size_t> out;
+    for (uint64_t identity : identities) {
+      auto it = positions.find(identity);
+      if (it == positions.end() || it->second.empty()) out.push_back(questions.size());
+      else {
+        out.push_back(it->second.back());
+        it->second.pop_back();
+      }
     }
+    return out;
+  }
+
+  /// A hash of every question in the bank (in order), identifying this exact snapshot.
+  uint64_t GetSnapshotHash() const {
+    Hasher hasher;
+    hasher.Add(questions.size());
+    for (auto q : questions) hasher.Add(q->GetContentHash());
+    return hasher.Get();
+  }
+
+  void SetRenderCache(emp::Ptr<RenderCache> in) { render_cache = in; }
+  void SetFileReader(emp::Ptr<FileReader> in) { file_reader = in; }
+  void SetScheduler(emp::Ptr<Scheduler> in) { scheduler = in; }
+  void SetSelectionCache(emp::Ptr<SelectionCache> in) { selection_cache = in; }
+  void SetTagIndex(emp::Ptr<TagIndex> in) { tag_index = in; }
+
+  /// Wrap each printed question in the templates provided (with the exam's title and filename).
+  void SetTemplates(emp::Ptr<const TemplateSet> in, const String & title, const String & base) {
+    templates = in;
+    template_title = title;
+    template_base = base;
+  }
+
+  void Print(std::ostream & os=std::cout) const {
+    _PrintEach(os, [this](std::ostream & out, size_t id){
+      _PrintQuestion(out, "qbl", id, 0, [&](std::ostream & q_out){ questions[id]->Print(q_out); });
+    });
+  }
+
+  void PrintD2L(std::ostream & os=std::cout) const {
+    _PrintEach(os, [this](std::ostream & out, size_t id){ PrintD2LQuestion(out, id); });
+  }
+
+  void PrintD2LQuestion(std::ostream & os, size_t id) const {
+    _PrintQuestion(os, "d2l", id, 0, [&](std::ostream & out){ questions[id]->PrintD2L(out); });
+  }
+
+  void PrintGradeScope(std::ostream & os=std::cout, bool compressed = false) const {
+    _PrintEach(os, [this, compressed](std::ostream & out, size_t id){
+      PrintGradeScopeQuestion(out, id, compressed);
+    });
+  }
+
+  void PrintGradeScopeQuestion(std::ostream & os, size_t id, bool compressed = false) const {
+    const char * format = compressed ? "gradescope-compressed" : "gradescope";
+    _PrintQuestion(os, format, id, id+1, [&](std::ostream & out){
+      questions[id]->PrintGradeScope(out, id+1, compressed);
+    });
+  }
+
+  void PrintHTML(std::ostream & os=std::cout) const {
+    _PrintEach(os, [this](std::ostream & out, size_t id){
+      _PrintQuestion(out, "html", id, id+1, [&](std::ostream & q_out){
+        questions[id]->PrintHTML(q_out, id+1);
+      });
+    });
+  }
+
+  void PrintJS(std::ostream & os=std::cout) const {
+    _PrintEach(os, [this](std::ostream & out, size_t id){
+      _PrintQuestion(out, "js", id, 0, [&](std::ostream & q_out){ questions[id]->PrintJS(q_out); });
+    });
   }
 
   void PrintLatex(std::ostream & os=std::cout) const {
-    for (size_t id = 0; id < questions.size(); ++id) {
-      questions[id]->PrintLatex(os);
+    _PrintEach(os, [this](std::ostream & out, size_t id){ PrintLatexQuestion(out, id); });
+  }
+
+  void PrintLatexQuestion(std::ostream & os, size_t id) const {
+    _PrintQuestion(os, "latex", id, 0, [&](std::ostream & out){ questions[id]->PrintLatex(out); });
+  }
+
+  /// Write the whole bank as a C++ header that can be compiled into QBL (see Embedded.hpp).
+  void PrintCpp(std::ostream & os) const {
+    emp::notify::TestWarning(asset_store.GetSize(),
+      "Assets are not compiled into the executable; their `@` lines will be dropped.");
+    // Give each distinct tag block an ID; own tags are written as a block too.
+    std::map<emp::Ptr<const TagSet>, size_t> block_ids;
+    emp::vector<const TagSet *> blocks;
+    emp::vector<size_t> own_ids;
+    emp::vector<size_t> shared_ids;
+    auto block_id = [&](emp::Ptr<const TagSet> tag_set) {
+      auto [it, is_new] = block_ids.emplace(tag_set, blocks.size());
+      if (is_new) blocks.push_back(tag_set.Raw());
+      return it->second;
+    };
+    for (auto q : questions) {
+      own_ids.push_back(blocks.size());
+      blocks.push_back(&q->GetOwnTags());
+      for (auto tag_set : q->GetSharedTags()) block_id(tag_set);
     }
+
+    os << "// Question bank for QBL, generated by `QBL --emit-cpp`; do not edit.\n"
+       << "#pragma once\n\n"
+       << "#include <array>\n\n"
+       << "#include \"Embedded.hpp\"\n\n";
+
+    size_t tag_count = 0;
+    std::stringstream tag_ss, block_ss;
+    for (const TagSet * tag_set : blocks) {
+      block_ss << "  EmbeddedTagBlock{" << tag_count << ", ";
+      const size_t start = tag_count;
+      for (const String & tag : tag_set->GetBaseTags()) {
+        tag_ss << "  EmbeddedTag{" << ToCppLiteral(tag.str()) << ", \"\"},\n";
+        ++tag_count;
+      }
+      for (const String & tag : tag_set->GetExclusiveTags()) {
+        tag_ss << "  EmbeddedTag{" << ToCppLiteral(tag.str()) << ", \"\"},\n";
+        ++tag_count;
+      }
+      for (const auto & [name, value] : tag_set->GetConfigTags()) {
+        tag_ss << "  EmbeddedTag{" << ToCppLiteral(name.str()) << ", "
+               << ToCppLiteral(value.str()) << "},\n";
+        ++tag_count;
+      }
+      block_ss << (tag_count - start) << "},\n";
+    }
+
+    size_t option_count = 0, shared_count = 0;
+    std::stringstream option_ss, shared_ss, question_ss;
+    for (size_t pos = 0; pos < questions.size(); ++pos) {
+      const Question & q = *questions[pos];
+      const auto options = q.GetOptionData();
+      const auto & shared = q.GetSharedTags();
+      question_ss << "  EmbeddedQuestion{" << ToCppLiteral(q.GetTypeName().str()) << ", "
+                  << q.GetID() << ", " << ToCppLiteral(q.GetSource().str())
+                  << ",\n    " << ToCppLiteral(q.GetQuestion().str())
+                  << ",\n    " << ToCppLiteral(q.GetAltQuestion().str())
+                  << ",\n    " << ToCppLiteral(q.GetExplanation().str())
+                  << ",\n    " << ToCppLiteral(q.GetHint().str())
+                  << ",\n    " << q.IsRequired() << ", " << q.IsFixed() << ", "
+                  << own_ids[pos] << ", " << shared_count << ", " << shared.size() << ", "
+                  << option_count << ", " << options.size() << "},\n";
+      for (auto tag_set : shared) shared_ss << "  " << block_id(tag_set) << ",\n";
+      for (const OptionData & opt : options) {
+        option_ss << "  EmbeddedOption{" << ToCppLiteral(opt.text.str()) << ", " << opt.is_correct
+                  << ", " << opt.is_fixed << ", " << opt.is_required << "},\n";
+      }
+      shared_count += shared.size();
+      option_count += options.size();
+    }
+
+    auto print_array = [&os](const char * type, const char * name, size_t count,
+                             const std::stringstream & entries) {
+      os << "static constexpr std::array<" << type << ", " << count << "> " << name << "{{\n"
+         << entries.str() << "}};\n\n";
+    };
+    std::stringstream source_ss;
+    for (const String & filename : source_files) source_ss << "  " << ToCppLiteral(filename.str()) << ",\n";
+    print_array("EmbeddedQuestion", "qbl_embedded_questions", questions.size(), question_ss);
+    print_array("EmbeddedOption", "qbl_embedded_options", option_count, option_ss);
+    print_array("EmbeddedTag", "qbl_embedded_tags", tag_count, tag_ss);
+    print_array("EmbeddedTagBlock", "qbl_embedded_blocks", blocks.size(), block_ss);
+    print_array("size_t", "qbl_embedded_shared_blocks", shared_count, shared_ss);
+    print_array("std::string_view", "qbl_embedded_sources", source_files.size(), source_ss);
+    os << "static constexpr EmbeddedBank qbl_embedded_bank{\n"
+       << "  qbl_embedded_questions, qbl_embedded_options, qbl_embedded_tags,\n"
+       << "  qbl_embedded_blocks, qbl_embedded_shared_blocks, qbl_embedded_sources\n"
+       << "};\n";
   }
 
-  void PrintDebug(std::ostream & os=std::cout) const {
+  /// Print the state of the bank, with how its questions were divided up by a selection
+  /// (if one is provided; otherwise none are decided yet).
+  void PrintDebug(std::ostream & os=std::cout, emp::Ptr<const Selection> sel=nullptr) const {
+    const size_t include_count = sel ? sel->include_count : 0;
+    const size_t exclude_count = sel ? sel->exclude_count : 0;
     os << "Question Bank\n"
        << "  source files:  " << MakeLiteral(source_files) << '\n'
        << "  num questions: " << questions.size() << '\n'
@@ -369,8 +1204,8 @@ public:
 
   void LogQuestions(String filename) const {
     emp::notify::Message("Printing log file of question IDs '", filename, "'.");
-    std::ofstream out_file(filename);
-    LogQuestions(out_file);
-    out_file.close();
+    std::stringstream ss;
+    LogQuestions(ss);
+    WriteIfChanged(filename, ss.str());
   }
 };
@@ -2,11 +2,13 @@
 
 #include "emp/math/random_utils.hpp"
 #include "functions.hpp"
+#include "Layout.hpp"
 
 using emp::MakeCount;
 
 void Question_MultipleChoice::Print(std::ostream& os) const {
   os << "%- QUESTION " << id << "\n" << question << "\n";
+  _PrintAssetsQBL(os);
   for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
     os << options[opt_id].GetQBLBullet() << " " << options[opt_id].text << '\n';
   }
@@ -17,10 +19,10 @@ void Question_MultipleChoice::PrintD2L(std::ostream& os) const {
   os << "NewQuestion,MC,,,\n"
     << "ID,QBL-" << id << ",,,\n"
     << "Title,,,,\n"
-    << "QuestionText," << TextToD2L(question) << ",HTML,,\n"
+    << "QuestionText," << TextToD2L(question) << _D2LAssetText() << ",HTML,,\n"
     << "Points," << GetPoints() << ",,,\n"
     << "Difficulty,1,,,\n"
-    << "Image,,,,\n";
+    << "Image," << _D2LImagePath() << ",,,\n";
   for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
     os << "Option," << (options[opt_id].is_correct ? 100 : 0) << ","
        << TextToD2L(options[opt_id].text) << ",HTML,"
@@ -33,16 +35,18 @@ void Question_MultipleChoice::PrintD2L(std::ostream& os) const {
 }
 
 void Question_MultipleChoice::PrintGradeScope(std::ostream& os, size_t q_num, bool compressed) const {
-  size_t opt_width = 0;
   size_t num_correct = correct_range.GetSize();
   std::string bubble_type = "\\chooseone ";
   if (num_correct > 1) {
     bubble_type = "\\choosemany ";
   }
-  
+
+  // Widths of each option (with its bubble), as estimated when the question was validated.
+  emp::vector<size_t> opt_widths(options.size());
+  size_t total_width = 0;
   for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
-    opt_width += 10; // Fixed amount per option.
-    opt_width += LineToRawText(options[opt_id].text).size();
+    opt_widths[opt_id] = layout::bubble_width + options[opt_id].width;
+    total_width += opt_widths[opt_id] + layout::wide_gap;
   }
 
   os << "% QUESTION ID " << id << "\n"
@@ -50,34 +54,39 @@ void Question_MultipleChoice::PrintGradeScope(std::ostream& os, size_t q_num, bo
      << "\\vspace{20pt}\\hangpara{1.8em}{1}\n"
      << q_num << ". " << TextToLatex(question);
 
-  if (opt_width < 100) {  // All on one line.
+  auto print_option = [this, &os, &bubble_type](size_t opt_id) {
+    os << bubble_type;
+    if (options[opt_id].is_correct) os << "\\showcorrect ";
+    os << TextToLatex(options[opt_id].text);
+  };
+
+  if (total_width <= layout::line_width) {  // All on one line.
     os << "\\\\\n"
        << "\\vspace{1pt}\\\\\n";
     for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
-      os << bubble_type;
-      if (options[opt_id].is_correct) os << "\\showcorrect ";
-      os << TextToLatex(options[opt_id].text) << " \\hspace*{3em}\n";
+      print_option(opt_id);
+      os << " \\hspace*{3em}\n";
     }
   } else if (compressed) {
+    // Pack options into as few (and as evenly filled) lines as possible.
+    emp::vector<size_t> line_starts = PackLines(opt_widths, layout::line_width, layout::narrow_gap);
+    size_t line_id = 0;
     os << "\\\\\n";
-    int curr_width = 0;
     for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
-      curr_width += 10 + LineToRawText(options[opt_id].text).size();
-      if (curr_width > 100) {
-        os << "\\\\\n";
-        curr_width = 10 + LineToRawText(options[opt_id].text).size();
+      if (line_id < line_starts.size() && line_starts[line_id] == opt_id) {
+        if (line_id) os << "\\\\\n";
+        ++line_id;
       }
-      os << bubble_type;
-      if (options[opt_id].is_correct) os << "\\showcorrect ";
-      os << TextToLatex(options[opt_id].text) << " \\hspace*{.5em}\n";
+      print_option(opt_id);
+      os << " \\hspace*{.5em}\n";
     }
   } else {
     os << "\n"
       << "\\begin{itemize}[label={}]\n";
     for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
-      os << "\\item " << bubble_type;
-      if (options[opt_id].is_correct) os << "\\showcorrect ";
-      os << TextToLatex(options[opt_id].text) << '\n';
+      os << "\\item ";
+      print_option(opt_id);
+      os << '\n';
     }
     os << "\\end{itemize}\n";
   }
@@ -92,6 +101,7 @@ void Question_MultipleChoice::PrintHTML(std::ostream & os, size_t q_num) const {
      << "    <p><b>";
   if (q_num) os << q_num << ".</b> ";  // If we were given a number > 0, print it.
   os << TextToHTML(question) <<  "</p>\n";
+  _PrintAssetsHTML(os);
 
   // Print options.
   for (size_t opt_id = 0; opt_id < options.size(); ++opt_id) {
@@ -116,8 +126,9 @@ void Question_MultipleChoice::PrintJS(std::ostream & os) const {
 void Question_MultipleChoice::PrintLatex(std::ostream& os) const {
   os << "% QUESTION " << id << "\n"
      << "\\question " << TextToLatex(question) << "\n"
-     << std::endl
-     << "\\begin{mcanswerslist}";
+     << std::endl;
+  _PrintAssetsLatex(os);
+  os << "\\begin{mcanswerslist}";
   size_t fixed_count = CountFixed();
   if (fixed_count) {
     if (fixed_count == 1 && HasFixedLast()) {
@@ -179,6 +190,12 @@ void Question_MultipleChoice::Validate() {
   while (test_pos < options.size() && options[test_pos].is_fixed) test_pos++;  // Back fixed.
   _TestError(test_pos < options.size(),
     "Has fixed-position options in middle; fixed positions must be at start and end.");
+
+  _ValidateText();
+  for (const Option & opt : options) _ValidateEntities(opt.text);
+
+  // Estimate how wide each option will print, for laying out options in GradeScope format.
+  for (Option & opt : options) opt.width = TextWidth(opt.text);
 }
 
 void Question_MultipleChoice::ReduceOptions(emp::Random& random, size_t correct_target,
@@ -229,8 +246,10 @@ void Question_MultipleChoice::ShuffleOptions(emp::Random& random) {
 
 void Question_MultipleChoice::Generate(emp::Random & random) {
   // Determine if we are going to toggle this question to its alternate form.
+  for (size_t i = 0; i < options.size(); ++i) options[i].pos = i;
   double alt_p = _GetConfig(":alt_prob", 0.5);
-  if (alt_question.size() && random.P(alt_p)) {
+  const bool use_alt = alt_question.size() && random.P(alt_p);
+  if (use_alt) {
     std::swap(question, alt_question);
     for (auto & opt : options) {
       opt.is_correct = !opt.is_correct;
@@ -251,4 +270,30 @@ void Question_MultipleChoice::Generate(emp::Random & random) {
 
   // Reorder the possible answers
   ShuffleOptions(random);
+
+  variant = use_alt ? "alt" : "main";
+  for (const Option & opt : options) variant.Append(' ', opt.pos);
+}
+
+bool Question_MultipleChoice::ApplyVariant(String in_variant) {
+  if (in_variant.empty()) return true;   // Not generated; use as is.
+  if (variant.size()) return false;      // Already generated.
+  variant = in_variant;
+
+  const String wording = in_variant.PopWord();
+  if (wording != "main" && wording != "alt") return false;
+  if (wording == "alt") {
+    std::swap(question, alt_question);
+    for (auto & opt : options) opt.is_correct = !opt.is_correct;
+  }
+
+  emp::vector<Option> new_options;
+  while (!in_variant.OnlyWhitespace()) {
+    const size_t pos = in_variant.PopWord().As<size_t>();
+    if (pos >= options.size()) return false;
+    new_options.push_back(options[pos]);
+    new_options.back().pos = pos;
+  }
+  options = new_options;
+  return true;
 }
@@ -11,6 +11,8 @@ private:
     bool is_fixed;     ///< Is this option in a fixed position?
     bool is_required;  ///< Does this option have to be included?
     String feedback;   ///< Feedback for a student picking this option.
+    size_t width = 0;  ///< Estimated printed width of text (set in Validate; see Layout.hpp)
+    size_t pos = 0;    ///< Position in the original question (set in Generate).
 
     String GetQBLBullet() const {
       String out("*");
@@ -25,6 +27,7 @@ private:
 
   emp::Range<size_t> correct_range;  ///< How many "correct" answers should there be?
   emp::Range<size_t> option_range;   ///< How many question options to show to students?
+  String variant = "";               ///< Choices made when generated; see GetVariant()
 
   template <typename FUN_T>
   size_t _Count(FUN_T fun) const {
@@ -44,6 +47,8 @@ public:
   Question_MultipleChoice & operator=(const Question_MultipleChoice &) = default;
   Question_MultipleChoice & operator=(Question_MultipleChoice &&) = default;
 
+  emp::Ptr<Question> Clone() const override { return emp::NewPtr<Question_MultipleChoice>(*this); }
+
   size_t CountCorrect() const { return _Count([](const Option & o){ return o.is_correct; }); }
   size_t CountIncorrect() const { return _Count([](const Option & o){ return !o.is_correct; }); }
   size_t CountRequired() const { return _Count([](const Option & o){ return o.is_required; }); }
@@ -70,11 +75,36 @@ public:
             (tag[0] == '['),    // Is it correct?
             tag.Has('>'),       // Is it in a fixed position?
             tag.Has('+'),       // Is it required?
-            ""                  // Explanation to student
+            "",                 // Explanation to student
+            0                   // Width (calculated once all text is loaded)
             });      
       last_edit = Section::OPTIONS;
   }
 
+  String GetTypeName() const override { return "multiple_choice"; }
+
+  emp::vector<OptionData> GetOptionData() const override {
+    emp::vector<OptionData> out;
+    for (const Option & opt : options) {
+      out.push_back(OptionData{opt.text, opt.is_correct, opt.is_fixed, opt.is_required});
+    }
+    return out;
+  }
+
+  void AddOptionData(const OptionData & data) override {
+    options.push_back(Option{data.text, data.is_correct, data.is_fixed, data.is_required, "", 0});
+    last_edit = Section::OPTIONS;
+  }
+
+  void AddDetailsToHash(Hasher & hasher) const override {
+    hasher.Add(options.size());
+    for (const Option & opt : options) {
+      hasher.Add(opt.text, opt.is_correct, opt.is_fixed, opt.is_required, opt.feedback);
+    }
+    hasher.Add(correct_range.GetLower(), correct_range.GetUpper(),
+               option_range.GetLower(), option_range.GetUpper());
+  }
+
   void Print(std::ostream & os=std::cout) const override;
   void PrintD2L(std::ostream & os=std::cout) const override;
   void PrintGradeScope(std::ostream & os=std::cout, size_t q_num=0, bool compressed = false) const override;
@@ -87,4 +117,9 @@ public:
 
   void Validate() override;
   void Generate(emp::Random & random) override;
+
+  /// Variants are "main" or "alt" (which wording was used) followed by the original position
+  /// of each option shown, in order; e.g., "alt 3 0 2".
+  String GetVariant() const override { return variant; }
+  bool ApplyVariant(String variant) override;
 };
\ No newline at end of file
@@ -4,6 +4,7 @@ using emp::MakeCount;
 
 void Question_ShortAnswer::Print(std::ostream& os) const {
   os << "%- QUESTION " << id << "\n" << question << "\n";
+  _PrintAssetsQBL(os);
   for (const String & option : answers) {
     os << option << '\n';
   }
@@ -14,10 +15,10 @@ void Question_ShortAnswer::PrintD2L(std::ostream& os) const {
   os << "NewQuestion,SA,,,\n"
     << "ID,QBL-" << id << ",,,\n"
     << "Title,,,,\n"
-    << "QuestionText," << TextToD2L(question) << ",HTML,,\n"
+    << "QuestionText," << TextToD2L(question) << _D2LAssetText() << ",HTML,,\n"
     << "Points," << points << ",,,\n"
     << "Difficulty,1,,,\n"
-    << "Image,,,,\n";
+    << "Image," << _D2LImagePath() << ",,,\n";
   for (const String & option : answers) {
     os << "Answer,100," << TextToD2L(option) << ",HTML,\n";
   }
@@ -52,6 +53,7 @@ void Question_ShortAnswer::PrintHTML(std::ostream & os, size_t q_num) const {
      << "    <p><b>";
   if (q_num) os << q_num << ".</b> ";  // If we were given a number > 0, print it.
   os << TextToHTML(question) <<  "</p>\n";
+  _PrintAssetsHTML(os);
   os << "<input type=\"text\" id=\"q" << id << "\">\n";
   
   // Leave a div to place the answer.
@@ -71,8 +73,9 @@ void Question_ShortAnswer::PrintJS(std::ostream & os) const {
 void Question_ShortAnswer::PrintLatex(std::ostream& os) const {
   os << "% QUESTION " << id << "\n"
      << "\\question " << TextToLatex(question) << "\n"
-     << std::endl
-     << "\\begin{saanswer}";
+     << std::endl;
+  _PrintAssetsLatex(os);
+  os << "\\begin{saanswer}";
   os << std::endl;
 
   for (const String & option : answers) {
@@ -85,4 +88,7 @@ void Question_ShortAnswer::PrintLatex(std::ostream& os) const {
 void Question_ShortAnswer::Validate() {
   // Is there at least one valid answer?
   _TestError(answers.size() == 0, "At least one answer required.");
+
+  _ValidateText();
+  for (const String & answer : answers) _ValidateEntities(answer);
 }
@@ -18,6 +18,8 @@ public:
   Question_ShortAnswer & operator=(const Question_ShortAnswer &) = default;
   Question_ShortAnswer & operator=(Question_ShortAnswer &&) = default;
 
+  emp::Ptr<Question> Clone() const override { return emp::NewPtr<Question_ShortAnswer>(*this); }
+
   void AddOption(const emp::String &) override {
     _Error("Short answer questions should not have a multi-line answer.");
   }
@@ -28,6 +30,21 @@ public:
     answers.push_back(answer);
   }
 
+  String GetTypeName() const override { return "short_answer"; }
+
+  emp::vector<OptionData> GetOptionData() const override {
+    emp::vector<OptionData> out;
+    for (const String & answer : answers) out.push_back(OptionData{answer});
+    return out;
+  }
+
+  void AddOptionData(const OptionData & data) override { answers.push_back(data.text); }
+
+  void AddDetailsToHash(Hasher & hasher) const override {
+    hasher.Add(answers.size());
+    for (const String & answer : answers) hasher.Add(answer);
+  }
+
   void Print(std::ostream & os=std::cout) const override;
   void PrintD2L(std::ostream & os=std::cout) const override;
   void PrintGradeScope(std::ostream & os=std::cout, size_t q_num=0, bool compressed = false) const override;
@@ -37,4 +54,7 @@ public:
 
   void Validate() override;
   void Generate(emp::Random &) override { /* No generation needed for short answer. */ }
+
+  String GetVariant() const override { return ""; }
+  bool ApplyVariant(String variant) override { return variant.empty(); }
 };
\ No newline at end of file
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "emp/base/notify.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+#include "Hash.hpp"
+
+using emp::String;
+
+// Increment whenever any renderer changes its output, so that stale cache entries are ignored.
+#define QBL_RENDER_VERSION 6
+
+// A persistent, content-addressed store of rendered question fragments.
+//
+// Entries are keyed by a hash of the (generated) question content, the output format, the
+// question's position, and the renderer version.  The store is a single file of records that
+// is memory-mapped for lookups; new entries are appended when the cache is saved.  If the file
+// would grow beyond its size limit, it is rewritten keeping the most recently used entries.
+// With no filename, the cache is kept in memory only (e.g., across reloads of a preview).
+class RenderCache {
+private:
+  static constexpr uint64_t MAGIC = 0x3145'4843'4C42'51ull;  // "QBLCHE1"
+
+  struct RecordHeader {
+    uint64_t key;        ///< Hash identifying this fragment.
+    uint32_t size;       ///< Number of bytes of rendered text following this header.
+    uint32_t last_used;  ///< Generation of the cache when this entry was last used.
+  };
+
+  struct Entry {
+    std::string_view text;    ///< Rendered text (in the mapped file or in new_text).
+    uint32_t last_used = 0;   ///< Generation when this entry was last used.
+    bool is_new = false;      ///< Was this entry added during this run?
+    size_t file_pos = 0;      ///< Position of this entry's record header in the file (if any).
+  };
+
+  String filename;
+  size_t max_bytes;              ///< Largest size to allow the cache file to grow to.
+  uint32_t generation = 1;       ///< Incremented each time the cache is loaded.
+  int fd = -1;
+  void * map_ptr = nullptr;
+  size_t map_size = 0;
+
+  std::unordered_map<uint64_t, Entry> entries;
+  std::deque<String> new_text;        ///< Storage for entries rendered during this run.
+  size_t hit_count = 0;
+  size_t miss_count = 0;
+  mutable std::mutex mutex;
+
+  // Map the cache file (shared and writable, so that usage times can be updated in place).
+  void _Load() {
+    if (filename.empty()) return;
+    fd = open(filename.c_str(), O_RDWR);
+    if (fd < 0) return;          // No cache yet; it will be created on save.
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(2*sizeof(uint64_t))) return;
+    map_size = static_cast<size_t>(st.st_size);
+    map_ptr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map_ptr == MAP_FAILED) { map_ptr = nullptr; map_size = 0; return; }
+
+    char * data = static_cast<char *>(map_ptr);
+    uint64_t header[2];   // Magic number and generation.
+    std::memcpy(header, data, sizeof(header));
+    if (header[0] != MAGIC) {
+      emp::notify::Warning("Render cache '", filename, "' has an unknown format; ignoring.");
+      _Unmap();
+      return;
+    }
+    generation = static_cast<uint32_t>(header[1]) + 1;
+    header[1] = generation;
+    std::memcpy(data, header, sizeof(header));
+
+    size_t pos = sizeof(header);
+    while (pos + sizeof(RecordHeader) <= map_size) {
+      RecordHeader record;
+      std::memcpy(&record, data + pos, sizeof(record));
+      const size_t record_pos = pos;
+      pos += sizeof(record);
+      if (pos + record.size > map_size) break;   // Truncated record; ignore the rest.
+      entries[record.key] =
+        Entry{ std::string_view(data + pos, record.size), record.last_used, false, record_pos };
+      pos += record.size;
+    }
+  }
+
+  // Record that an entry was used in this run (in the mapped file too, if it is there).
+  void _Touch(Entry & entry) {
+    entry.last_used = generation;
+    if (!entry.file_pos || !map_ptr) return;
+    char * record_ptr = static_cast<char *>(map_ptr) + entry.file_pos;
+    std::memcpy(record_ptr + offsetof(RecordHeader, last_used), &generation, sizeof(generation));
+  }
+
+  void _Unmap() {
+    if (map_ptr) munmap(map_ptr, map_size);
+    if (fd >= 0) close(fd);
+    map_ptr = nullptr;
+    map_size = 0;
+    fd = -1;
+  }
+
+  static void _WriteRecord(std::ostream & os, uint64_t key, const Entry & entry) {
+    RecordHeader record{key, static_cast<uint32_t>(entry.text.size()), entry.last_used};
+    os.write(reinterpret_cast<const char *>(&record), sizeof(record));
+    os.write(entry.text.data(), static_cast<std::streamsize>(entry.text.size()));
+  }
+
+  static size_t _RecordSize(const Entry & entry) { return sizeof(RecordHeader) + entry.text.size(); }
+
+public:
+  RenderCache(const String & filename, size_t max_bytes=64*1024*1024)
+    : filename(filename), max_bytes(max_bytes) { _Load(); }
+  RenderCache(const RenderCache &) = delete;
+  ~RenderCache() {
+    Save();
+    _Unmap();
+  }
+
+  /// Build the key for a rendered fragment.
+  static uint64_t MakeKey(uint64_t content_hash, std::string_view format, size_t q_num) {
+    return HashValues(content_hash, format, q_num, QBL_RENDER_VERSION);
+  }
+
+  /// Look up a fragment; if found, write it to the output stream and return true.
+  bool Lookup(uint64_t key, std::ostream & os) {
+    std::lock_guard lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) { ++miss_count; return false; }
+    _Touch(it->second);
+    os.write(it->second.text.data(), static_cast<std::streamsize>(it->second.text.size()));
+    ++hit_count;
+    return true;
+  }
+
+  /// Add a newly rendered fragment to the cache.
+  void Store(uint64_t key, const String & text) {
+    std::lock_guard lock(mutex);
+    if (entries.contains(key)) return;
+    new_text.push_back(text);
+    entries[key] = Entry{ std::string_view(new_text.back().str()), generation, true };
+  }
+
+  size_t GetHitCount() const { std::lock_guard lock(mutex); return hit_count; }
+  size_t GetMissCount() const { std::lock_guard lock(mutex); return miss_count; }
+
+  /// Memory used by the cache: the mapped file and any text rendered this run, in bytes.
+  size_t GetMemoryBytes() const {
+    std::lock_guard lock(mutex);
+    size_t bytes = map_size + entries.size() * sizeof(Entry);
+    for (const String & text : new_text) bytes += text.size();
+    return bytes;
+  }
+
+  /// Write any new entries to disk.  New entries are appended unless that would take the file
+  /// past its size limit; then the file is rewritten with the most recently used entries.
+  void Save() {
+    if (filename.empty()) return;
+    std::lock_guard lock(mutex);
+    size_t new_bytes = 0;
+    size_t total_bytes = 2*sizeof(uint64_t);
+    for (const auto & [key, entry] : entries) {
+      total_bytes += _RecordSize(entry);
+      if (entry.is_new) new_bytes += _RecordSize(entry);
+    }
+    if (new_bytes == 0 && total_bytes <= max_bytes) return;   // Nothing to do.
+
+    const uint64_t header[2] = { MAGIC, generation };
+    if (map_ptr && total_bytes <= max_bytes) {
+      std::ofstream out(filename.str(), std::ios::binary | std::ios::app);
+      for (auto & [key, entry] : entries) {
+        if (entry.is_new) _WriteRecord(out, key, entry);
+      }
+    }
+    else {
+      // Evict least recently used entries until we fit, then rewrite the file.
+      emp::vector<std::pair<uint64_t, const Entry *>> keep;
+      for (const auto & [key, entry] : entries) keep.emplace_back(key, &entry);
+      std::sort(keep.begin(), keep.end(), [](const auto & a, const auto & b){
+        if (a.second->last_used != b.second->last_used) {
+          return a.second->last_used > b.second->last_used;
+        }
+        return a.first < b.first;
+      });
+      const String tmp_filename = filename + ".tmp";
+      {
+        std::ofstream out(tmp_filename.str(), std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(header), sizeof(header));
+        size_t used_bytes = sizeof(header);
+        for (const auto & [key, entry] : keep) {
+          if (used_bytes + _RecordSize(*entry) > max_bytes) continue;
+          _WriteRecord(out, key, *entry);
+          used_bytes += _RecordSize(*entry);
+        }
+      }
+      std::filesystem::rename(tmp_filename.str(), filename.str());
+    }
+
+    // Everything is now on disk, so nothing needs to be saved again.
+    for (auto & [key, entry] : entries) entry.is_new = false;
+  }
+};
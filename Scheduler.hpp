@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "emp/base/Ptr.hpp"
+#include "emp/base/vector.hpp"
+
+// A work-stealing task scheduler shared by every phase of QBL (reading, validation, variant
+// generation, rendering, and batch jobs), sized by the -j flag.  Each worker has its own
+// deque: it pushes and pops new tasks at the back (so nested work stays local and cache-warm)
+// while idle workers steal from the front of the others.  A thread waiting on a task group
+// runs queued tasks itself rather than blocking, so tasks may wait on nested groups, and
+// with -j 1 everything simply runs on the calling thread.
+//
+// Results never depend on which thread ran what: ParallelMap() and OrderedReduce() keep
+// results in index order, and anything random must be seeded per item, not per thread.
+class Scheduler {
+public:
+  /// Tracks a set of tasks so that their caller can wait for all of them to finish.
+  class TaskGroup {
+    friend class Scheduler;
+    std::atomic<size_t> remaining = 0;
+    std::exception_ptr exception = nullptr;   ///< First exception thrown by a task (if any).
+    std::mutex mutex;
+  };
+
+private:
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+    std::atomic<uint64_t> busy_ns = 0;     ///< Time spent running tasks taken by this thread.
+    std::atomic<uint64_t> task_count = 0;  ///< Tasks run by this thread.
+  };
+
+  emp::vector<emp::Ptr<WorkQueue>> queues;   ///< One per worker; queue 0 is for other threads.
+  emp::vector<std::thread> threads;
+  std::atomic<size_t> queued_count = 0;      ///< Tasks waiting in any queue.
+  std::atomic<bool> stopping = false;
+  std::mutex sleep_mutex;
+  std::condition_variable sleep_cv;          ///< Idle workers wait here for new tasks.
+
+  // Which of our queues belongs to the current thread (0 if it is not one of our workers).
+  size_t _QueueID() const {
+    return (tl_scheduler == this) ? tl_queue_id : 0;
+  }
+
+  static inline thread_local const Scheduler * tl_scheduler = nullptr;
+  static inline thread_local size_t tl_queue_id = 0;
+  static inline thread_local size_t tl_task_depth = 0;   ///< Tasks running on this thread.
+
+  void _Push(std::function<void()> && task) {
+    WorkQueue & queue = *queues[_QueueID()];
+    {
+      std::lock_guard lock(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+    }
+    ++queued_count;
+    { std::lock_guard lock(sleep_mutex); }    // Don't let a worker miss the notification.
+    sleep_cv.notify_one();
+  }
+
+  // Run one queued task (our own newest first, otherwise the oldest from another queue).
+  bool _TryRunOne() {
+    if (queued_count.load(std::memory_order_acquire) == 0) return false;
+    const size_t my_id = _QueueID();
+    std::function<void()> task;
+    for (size_t offset = 0; offset < queues.size() && !task; ++offset) {
+      WorkQueue & queue = *queues[(my_id + offset) % queues.size()];
+      std::lock_guard lock(queue.mutex);
+      if (queue.tasks.empty()) continue;
+      if (offset == 0) { task = std::move(queue.tasks.back()); queue.tasks.pop_back(); }
+      else { task = std::move(queue.tasks.front()); queue.tasks.pop_front(); }
+    }
+    if (!task) return false;
+    --queued_count;
+
+    // Time only the outermost task, since a task waiting on a group runs others inside it.
+    const auto start_time = std::chrono::steady_clock::now();
+    ++tl_task_depth;
+    task();
+    if (--tl_task_depth == 0) {
+      const auto busy = std::chrono::steady_clock::now() - start_time;
+      WorkQueue & queue = *queues[my_id];
+      queue.busy_ns.fetch_add(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(busy).count()),
+        std::memory_order_relaxed);
+      queue.task_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  void _RunWorker(size_t queue_id) {
+    tl_scheduler = this;
+    tl_queue_id = queue_id;
+    while (!stopping) {
+      if (_TryRunOne()) continue;
+      std::unique_lock lock(sleep_mutex);
+      sleep_cv.wait(lock, [this](){ return stopping || queued_count > 0; });
+    }
+  }
+
+public:
+  /// Use thread_count threads in all, including the one calling into the scheduler (so
+  /// thread_count-1 workers are started); 0 means one per hardware thread.
+  Scheduler(size_t thread_count=0) {
+    if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < thread_count; ++i) queues.push_back(emp::NewPtr<WorkQueue>());
+    for (size_t i = 1; i < thread_count; ++i) threads.emplace_back([this, i](){ _RunWorker(i); });
+  }
+  Scheduler(const Scheduler &) = delete;
+  ~Scheduler() {
+    {
+      std::lock_guard lock(sleep_mutex);
+      stopping = true;
+    }
+    sleep_cv.notify_all();
+    for (auto & thread : threads) thread.join();
+    for (auto queue : queues) queue.Delete();
+  }
+
+  size_t GetThreadCount() const { return queues.size(); }
+
+  /// Total time spent running queued tasks, over all threads (for utilization metrics).
+  double GetBusySeconds() const {
+    uint64_t busy_ns = 0;
+    for (auto queue : queues) busy_ns += queue->busy_ns.load(std::memory_order_relaxed);
+    return static_cast<double>(busy_ns) / 1e9;
+  }
+
+  /// Number of queued tasks run so far (tasks run directly with -j 1 are not counted).
+  size_t GetTaskCount() const {
+    size_t count = 0;
+    for (auto queue : queues) count += queue->task_count.load(std::memory_order_relaxed);
+    return count;
+  }
+
+  /// Queue a task as part of a group; use Wait() on the group before it goes out of scope.
+  template <typename FUN_T>
+  void Run(TaskGroup & group, FUN_T && fun) {
+    ++group.remaining;
+    auto task = [&group, fun = std::forward<FUN_T>(fun)]() mutable {
+      try { fun(); }
+      catch (...) {
+        std::lock_guard lock(group.mutex);
+        if (!group.exception) group.exception = std::current_exception();
+      }
+      group.remaining.fetch_sub(1, std::memory_order_release);
+    };
+    if (threads.empty()) task();    // No workers; just run it now.
+    else _Push(std::move(task));
+  }
+
+  /// Wait for every task in the group to finish, running queued tasks in the meantime.
+  /// Rethrows the first exception thrown by any of the group's tasks.
+  void Wait(TaskGroup & group) {
+    while (group.remaining.load(std::memory_order_acquire)) {
+      if (!_TryRunOne()) std::this_thread::yield();
+    }
+    if (group.exception) std::rethrow_exception(std::exchange(group.exception, nullptr));
+  }
+
+  /// Run queued tasks until ready() returns true; used to wait for one result of a group
+  /// without waiting for all of them.
+  template <typename FUN_T>
+  void WaitUntil(FUN_T && ready) {
+    while (!ready()) {
+      if (!_TryRunOne()) std::this_thread::yield();
+    }
+  }
+
+  /// Call fun(i) for every i in [begin, end), split into chunks of at least min_chunk.
+  template <typename FUN_T>
+  void ParallelFor(size_t begin, size_t end, FUN_T && fun, size_t min_chunk=1) {
+    if (end <= begin) return;
+    const size_t count = end - begin;
+    if (threads.empty() || count <= min_chunk) {
+      for (size_t i = begin; i < end; ++i) fun(i);
+      return;
+    }
+    // A few chunks per thread lets stealing even out uneven items.
+    const size_t chunk_count = std::min((count + min_chunk - 1) / min_chunk, 4 * queues.size());
+    const size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+    TaskGroup group;
+    for (size_t start = begin; start < end; start += chunk_size) {
+      const size_t stop = std::min(end, start + chunk_size);
+      Run(group, [start, stop, &fun](){ for (size_t i = start; i < stop; ++i) fun(i); });
+    }
+    Wait(group);
+  }
+
+  /// Call fun(i) for every i in [0, count) and return the results, in order.
+  template <typename T, typename FUN_T>
+  emp::vector<T> ParallelMap(size_t count, FUN_T && fun, size_t min_chunk=1) {
+    emp::vector<T> results(count);
+    ParallelFor(0, count, [&](size_t i){ results[i] = fun(i); }, min_chunk);
+    return results;
+  }
+
+  /// Compute fun(i) for every i in [0, count) in parallel, then combine the results in index
+  /// order (result = reduce(result, value_i)), so the answer is the same for any -j.
+  template <typename T, typename FUN_T, typename REDUCE_T>
+  T OrderedReduce(size_t count, FUN_T && fun, T init, REDUCE_T && reduce, size_t min_chunk=1) {
+    auto values = ParallelMap<T>(count, std::forward<FUN_T>(fun), min_chunk);
+    for (T & value : values) init = reduce(std::move(init), std::move(value));
+    return init;
+  }
+};
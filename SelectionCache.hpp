@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "emp/base/vector.hpp"
+#include "emp/bits/BitVector.hpp"
+#include "emp/tools/String.hpp"
+
+#include "Hash.hpp"
+
+using emp::String;
+
+// Caches for exam requests that repeat, as in large batches or a resident QBL: thousands of
+// requests often share the same tag filters (e.g. `-r cse101 -x retired`) and differ only in
+// their seed or question count, and some repeat exactly.
+//
+// Candidate sets are bit vectors over the bank (one bit per question position) recording
+// which questions a request's filter rules out, for each combination of exclude and require
+// tags.  They are keyed by the normalized filter, with its tags sorted and deduplicated, so
+// `-x b,a` and `-x a -x b` share an entry.  Responses are whole rendered
+// exams, kept only for requests that are fully determined by their spec (a fixed seed).
+// Every entry belongs to one snapshot of the bank; setting a new snapshot drops them all.
+class SelectionCache {
+public:
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+
+    double GetHitRate() const {
+      return hits + misses ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0;
+    }
+  };
+
+private:
+  uint64_t snapshot = 0;                                ///< Bank snapshot the entries are for.
+  std::unordered_map<uint64_t, emp::BitVector> candidates;
+  std::unordered_map<uint64_t, std::string> responses;
+  std::deque<uint64_t> response_order;                  ///< Response keys, oldest first.
+  size_t response_bytes = 0;                            ///< Total size of all responses.
+  size_t max_response_bytes;                            ///< Oldest responses go beyond this.
+  mutable std::mutex mutex;
+
+  std::atomic<size_t> candidate_hits = 0;
+  std::atomic<size_t> candidate_misses = 0;
+  std::atomic<size_t> response_hits = 0;
+  std::atomic<size_t> response_misses = 0;
+
+public:
+  SelectionCache(size_t max_response_bytes=64*1024*1024)
+    : max_response_bytes(max_response_bytes) { }
+  SelectionCache(const SelectionCache &) = delete;
+
+  /// Tags in a canonical order (sorted, without repeats) for use in a key.
+  static emp::vector<String> Normalize(emp::vector<String> tags) {
+    std::sort(tags.begin(), tags.end());
+    tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
+    return tags;
+  }
+
+  /// Add a list of tags to a hasher (with its size, so adjacent lists cannot run together).
+  static void AddTags(Hasher & hasher, const emp::vector<String> & tags) {
+    hasher.Add(tags.size());
+    for (const String & tag : tags) hasher.Add(tag);
+  }
+
+  /// Use entries for a new snapshot of the bank (see QuestionBank::GetSnapshotHash()); if it
+  /// differs from the current one, every entry is dropped.
+  void SetSnapshot(uint64_t in_snapshot) {
+    std::lock_guard lock(mutex);
+    if (in_snapshot == snapshot) return;
+    snapshot = in_snapshot;
+    candidates.clear();
+    responses.clear();
+    response_order.clear();
+    response_bytes = 0;
+  }
+  uint64_t GetSnapshot() const { std::lock_guard lock(mutex); return snapshot; }
+
+  /// Find the candidate set for a key, or compute it with compute_fun() and store it.  A copy
+  /// is returned, so it stays valid whatever else happens to the cache.
+  template <typename FUN_T>
+  emp::BitVector GetCandidates(uint64_t key, FUN_T && compute_fun) {
+    {
+      std::lock_guard lock(mutex);
+      auto it = candidates.find(key);
+      if (it != candidates.end()) { ++candidate_hits; return it->second; }
+    }
+    ++candidate_misses;
+    emp::BitVector bits = compute_fun();   // Computed unlocked; a racing thread gets the same.
+    std::lock_guard lock(mutex);
+    candidates.emplace(key, bits);
+    return bits;
+  }
+
+  /// If a response is cached under the key, write it to os and return true.
+  bool LookupResponse(uint64_t key, std::ostream & os) {
+    std::lock_guard lock(mutex);
+    auto it = responses.find(key);
+    if (it == responses.end()) { ++response_misses; return false; }
+    ++response_hits;
+    os << it->second;
+    return true;
+  }
+
+  /// Keep a rendered response, dropping the oldest ones if the cache grows too large.
+  void StoreResponse(uint64_t key, std::string_view text) {
+    if (text.size() > max_response_bytes) return;
+    std::lock_guard lock(mutex);
+    if (!responses.emplace(key, std::string(text)).second) return;
+    response_order.push_back(key);
+    response_bytes += text.size();
+    while (response_bytes > max_response_bytes) {
+      auto it = responses.find(response_order.front());
+      response_bytes -= it->second.size();
+      responses.erase(it);
+      response_order.pop_front();
+    }
+  }
+
+  Stats GetCandidateStats() const { return Stats{candidate_hits, candidate_misses}; }
+  Stats GetResponseStats() const { return Stats{response_hits, response_misses}; }
+  size_t GetCandidateCount() const { std::lock_guard lock(mutex); return candidates.size(); }
+  size_t GetResponseCount() const { std::lock_guard lock(mutex); return responses.size(); }
+  size_t GetResponseBytes() const { std::lock_guard lock(mutex); return response_bytes; }
+
+  /// Approximate memory used by all entries, in bytes.
+  size_t GetMemoryBytes() const {
+    std::lock_guard lock(mutex);
+    size_t bytes = response_bytes;
+    for (const auto & [key, bits] : candidates) bytes += sizeof(key) + bits.GetSize() / 8;
+    return bytes;
+  }
+
+  void PrintStats(std::ostream & os) const {
+    const Stats candidate_stats = GetCandidateStats();
+    const Stats response_stats = GetResponseStats();
+    os << std::fixed << std::setprecision(1)
+       << "Selection cache: " << candidate_stats.hits << " candidate set hits, "
+       << candidate_stats.misses << " misses (" << (100.0 * candidate_stats.GetHitRate())
+       << "%); " << response_stats.hits << " response hits, " << response_stats.misses
+       << " misses (" << (100.0 * response_stats.GetHitRate()) << "%)." << std::endl;
+  }
+};
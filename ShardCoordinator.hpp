@@ -0,0 +1,174 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "emp/base/notify.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+using emp::String;
+
+// Run a batch of exam jobs across several worker QBL processes (shards).  Each shard gets a
+// contiguous block of the runnable jobs in its own batch file; shards whose worker crashed or could not
+// start are retried, and the per-shard reports are merged back in job order so the result
+// does not depend on timing.  All shard files live in a work directory, so workers only need
+// a shared filesystem.
+class ShardCoordinator {
+private:
+  struct Shard {
+    emp::vector<size_t> job_ids;  ///< Positions (in full batch) of the jobs in this shard.
+    String job_file;        ///< Batch file with just this shard's jobs.
+    String report_file;     ///< Where the worker should report results.
+    String log_file;        ///< Where the worker's standard output and errors go.
+    size_t attempts = 0;    ///< How many times has this shard been started?
+    bool succeeded = false; ///< Did this shard finish successfully?
+  };
+
+  String exe;                       ///< Program to run for each worker (normally this QBL).
+  emp::vector<String> worker_args;  ///< Extra arguments for every worker (e.g., question files)
+  String work_dir;                  ///< Directory for shard job files, reports, and logs.
+  size_t max_attempts = 3;          ///< How many times to try a shard before giving up?
+  emp::vector<Shard> shards;
+
+  pid_t _Launch(Shard & shard) const {
+    emp::vector<std::string> args{exe.str(), "-b", shard.job_file.str(),
+                                  "-B", shard.report_file.str()};
+    for (const String & arg : worker_args) args.push_back(arg.str());
+    std::filesystem::remove(shard.report_file.str());
+
+    pid_t pid = fork();
+    if (pid == 0) {   // Worker process: send output to the log file and run the job.
+      int log_fd = open(shard.log_file.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+      if (log_fd >= 0) { dup2(log_fd, STDOUT_FILENO); dup2(log_fd, STDERR_FILENO); close(log_fd); }
+      emp::vector<char *> argv;
+      for (auto & arg : args) argv.push_back(arg.data());
+      argv.push_back(nullptr);
+      execvp(argv[0], argv.data());
+      _exit(127);     // Only reached if exec failed.
+    }
+    return pid;
+  }
+
+  // A shard only counts as done if every one of its jobs was reported.
+  bool _CheckReport(const Shard & shard) const {
+    std::ifstream report(shard.report_file.str());
+    size_t count = 0;
+    std::string line;
+    while (std::getline(report, line)) if (line.size()) ++count;
+    return count == shard.job_ids.size();
+  }
+
+public:
+  ShardCoordinator(const String & exe, const emp::vector<String> & worker_args,
+                   const String & work_dir)
+    : exe(exe), worker_args(worker_args), work_dir(work_dir) { }
+
+  void SetMaxAttempts(size_t in) { max_attempts = std::max<size_t>(in, 1); }
+
+  /// Split the job lines across shard_count workers, run them, and write the merged report.
+  /// Jobs in `skipped` (by position, with the rest of their report line) are not run; they
+  /// were rejected before sharding.  Returns true if every shard eventually succeeded.
+  bool Run(const emp::vector<String> & job_lines, const std::map<size_t, String> & skipped,
+           size_t shard_count, const String & report_filename) {
+    std::filesystem::create_directories(work_dir.str());
+    emp::vector<size_t> run_ids;
+    for (size_t job_id = 0; job_id < job_lines.size(); ++job_id) {
+      if (!skipped.contains(job_id)) run_ids.push_back(job_id);
+    }
+    shard_count = std::clamp<size_t>(shard_count, 1, std::max<size_t>(run_ids.size(), 1));
+
+    // Partition the jobs to run into contiguous blocks, one per shard.
+    shards.resize(shard_count);
+    const size_t base_size = run_ids.size() / shard_count;
+    const size_t extra = run_ids.size() % shard_count;
+    size_t next_job = 0;
+    for (size_t shard_id = 0; shard_id < shard_count; ++shard_id) {
+      Shard & shard = shards[shard_id];
+      const String prefix = emp::MakeString(work_dir, "/shard", shard_id);
+      const size_t num_jobs = base_size + (shard_id < extra ? 1 : 0);
+      shard.job_file = prefix + ".jobs";
+      shard.report_file = prefix + ".report";
+      shard.log_file = prefix + ".log";
+      std::ofstream job_file(shard.job_file.str());
+      for (size_t i = 0; i < num_jobs; ++i) {
+        shard.job_ids.push_back(run_ids[next_job++]);
+        job_file << job_lines[shard.job_ids.back()] << '\n';
+      }
+    }
+
+    // Launch all shards, then relaunch any that fail until they succeed or run out of tries.
+    std::map<pid_t, size_t> running;   // Process ID -> shard ID
+    for (size_t shard_id = 0; shard_id < shards.size(); ++shard_id) {
+      shards[shard_id].attempts++;
+      pid_t pid = _Launch(shards[shard_id]);
+      if (pid > 0) running[pid] = shard_id;
+      else emp::notify::Warning("Unable to start worker for shard ", shard_id, ".");
+    }
+    while (running.size()) {
+      int status = 0;
+      pid_t pid = waitpid(-1, &status, 0);
+      if (pid < 0) break;
+      if (!running.contains(pid)) continue;
+      const size_t shard_id = running[pid];
+      running.erase(pid);
+
+      Shard & shard = shards[shard_id];
+      const bool exit_ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+      if (exit_ok && _CheckReport(shard)) { shard.succeeded = true; continue; }
+
+      // Only retry a worker that was killed by a signal (e.g., a crash or the OOM killer) or
+      // that could not be started (exit 127 from _Launch); any other failure would recur.
+      const bool exec_failed = WIFEXITED(status) && WEXITSTATUS(status) == 127;
+      if (!WIFSIGNALED(status) && !exec_failed) {
+        const String reason = exit_ok ? String("incomplete report")
+                                      : emp::MakeString("exit status ", WEXITSTATUS(status));
+        emp::notify::Warning("Shard ", shard_id, " failed (", reason, "); see '",
+                             shard.log_file, "'.");
+      } else if (shard.attempts < max_attempts) {
+        emp::notify::Warning("Shard ", shard_id, " failed (attempt ", shard.attempts,
+                             "); see '", shard.log_file, "'.  Retrying.");
+        shard.attempts++;
+        pid_t new_pid = _Launch(shard);
+        if (new_pid > 0) running[new_pid] = shard_id;
+      } else {
+        emp::notify::Warning("Shard ", shard_id, " failed after ", shard.attempts,
+                             " attempts; see '", shard.log_file, "'.");
+      }
+    }
+
+    // Merge the shard reports in job order, renumbering each job to its place in the batch.
+    std::map<size_t, String> results = skipped;   // Job position -> rest of report line
+    for (const Shard & shard : shards) {
+      std::ifstream shard_report(shard.report_file.str());
+      std::string line;
+      while (shard.succeeded && std::getline(shard_report, line)) {
+        String result(line);
+        if (result.OnlyWhitespace()) continue;
+        const size_t local_id = result.Pop('\t').As<size_t>();
+        if (local_id >= 1 && local_id <= shard.job_ids.size()) {
+          results[shard.job_ids[local_id-1]] = result;
+        }
+      }
+    }
+    std::ofstream report(report_filename.str());
+    bool all_ok = true;
+    for (size_t job_id = 0; job_id < job_lines.size(); ++job_id) {
+      report << (job_id + 1) << '\t';
+      if (results.contains(job_id)) report << results[job_id] << '\n';
+      else { report << "failed\t0\t-\n"; all_ok = false; }
+    }
+
+    std::cout << "Ran " << job_lines.size() << " jobs in " << shards.size() << " shards; "
+              << "report in '" << report_filename << "'." << std::endl;
+    return all_ok;
+  }
+};
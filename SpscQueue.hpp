@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+// A bounded, lock-free queue for passing items from exactly one producer thread to exactly one
+// consumer thread.  The producer only writes `tail` and the consumer only writes `head`, so
+// each side needs just an acquire load of the other's index; they live on separate cache
+// lines to avoid false sharing.  When the queue is full (or empty) the waiting side yields.
+template <typename T, size_t CAPACITY=256>
+class SpscQueue {
+private:
+  static_assert(CAPACITY && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two.");
+  static constexpr size_t MASK = CAPACITY - 1;
+  static constexpr size_t CACHE_LINE = 64;
+
+  std::array<T, CAPACITY> items;
+  alignas(CACHE_LINE) std::atomic<size_t> head = 0;    ///< Next position to pop (consumer).
+  alignas(CACHE_LINE) std::atomic<size_t> tail = 0;    ///< Next position to push (producer).
+  alignas(CACHE_LINE) std::atomic<bool> closed = false; ///< Has the producer finished?
+
+public:
+  SpscQueue() { }
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue & operator=(const SpscQueue &) = delete;
+
+  /// Add an item if there is room; returns false (leaving the item untouched) if full.
+  bool TryPush(T & item) {
+    const size_t cur_tail = tail.load(std::memory_order_relaxed);
+    if (cur_tail - head.load(std::memory_order_acquire) == CAPACITY) return false;
+    items[cur_tail & MASK] = std::move(item);
+    tail.store(cur_tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Add an item, waiting for room if needed.
+  void Push(T item) {
+    while (!TryPush(item)) std::this_thread::yield();
+  }
+
+  /// Remove the next item if there is one; returns false if the queue is currently empty.
+  bool TryPop(T & out) {
+    const size_t cur_head = head.load(std::memory_order_relaxed);
+    if (cur_head == tail.load(std::memory_order_acquire)) return false;
+    out = std::move(items[cur_head & MASK]);
+    head.store(cur_head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Remove the next item, waiting for one if needed.  Returns false once the queue has been
+  /// closed and everything pushed before closing has been popped.
+  bool Pop(T & out) {
+    while (!TryPop(out)) {
+      if (closed.load(std::memory_order_acquire)) return TryPop(out);
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  /// Called by the producer once it will push no more items.
+  void Close() { closed.store(true, std::memory_order_release); }
+};
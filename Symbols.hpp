@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// How to write non-ASCII characters in each output format.  HTML and D2L output are UTF-8, so
+// characters pass straight through; Latex needs a macro for most symbols, and raw text needs
+// a plain ASCII approximation.  The table covers every character with an HTML entity name
+// (see Entities.hpp), including the few ASCII characters that have one.
+
+struct SymbolInfo {
+  uint32_t codepoint;       ///< Unicode code point for this symbol.
+  std::string_view latex;   ///< How to produce this symbol in Latex.
+  std::string_view raw;     ///< Closest plain ASCII text.
+};
+
+// Must be sorted by code point (checked below).
+static constexpr SymbolInfo symbol_table[] = {
+  { 0x0022, "\"", "\"" },                           // "
+  { 0x0026, "\\&", "&" },                          // &
+  { 0x0027, "'", "'" },                             // '
+  { 0x003C, "$<$", "<" },                           // <
+  { 0x003E, "$>$", ">" },                           // >
+  { 0x00A0, "~", " " },                             // no-break space
+  { 0x00A1, "!`", "!" },                            // ¡
+  { 0x00A2, "\\textcent{}", "c" },                  // ¢
+  { 0x00A3, "\\pounds{}", "GBP" },                  // £
+  { 0x00A4, "\\textcurrency{}", "$" },              // ¤
+  { 0x00A5, "\\textyen{}", "JPY" },                 // ¥
+  { 0x00A6, "\\textbrokenbar{}", "|" },             // ¦
+  { 0x00A7, "\\S{}", "S" },                         // §
+  { 0x00A8, "\\\"{}", "\"" },                       // ¨
+  { 0x00A9, "\\copyright{}", "(c)" },               // ©
+  { 0x00AA, "\\textordfeminine{}", "a" },           // ª
+  { 0x00AB, "\\guillemotleft{}", "<<" },            // «
+  { 0x00AC, "$\\neg$", "!" },                       // ¬
+  { 0x00AD, "\\-", "" },                            // soft hyphen
+  { 0x00AE, "\\textregistered{}", "(R)" },          // ®
+  { 0x00AF, "\\={}", "-" },                         // ¯
+  { 0x00B0, "$^\\circ$", "deg" },                   // °
+  { 0x00B1, "$\\pm$", "+/-" },                      // ±
+  { 0x00B2, "$^2$", "^2" },                         // ²
+  { 0x00B3, "$^3$", "^3" },                         // ³
+  { 0x00B4, "\\'{}", "'" },                         // ´
+  { 0x00B5, "$\\mu$", "u" },                        // µ
+  { 0x00B6, "\\P{}", "P" },                         // ¶
+  { 0x00B7, "$\\cdot$", "." },                      // ·
+  { 0x00B8, "\\c{}", "," },                         // ¸
+  { 0x00B9, "$^1$", "^1" },                         // ¹
+  { 0x00BA, "\\textordmasculine{}", "o" },          // º
+  { 0x00BB, "\\guillemotright{}", ">>" },           // »
+  { 0x00BC, "$\\frac{1}{4}$", "1/4" },              // ¼
+  { 0x00BD, "$\\frac{1}{2}$", "1/2" },              // ½
+  { 0x00BE, "$\\frac{3}{4}$", "3/4" },              // ¾
+  { 0x00BF, "?`", "?" },                            // ¿
+  { 0x00C0, "\\`{A}", "A" },                        // À
+  { 0x00C1, "\\'{A}", "A" },                        // Á
+  { 0x00C2, "\\^{A}", "A" },                        // Â
+  { 0x00C3, "\\~{A}", "A" },                        // Ã
+  { 0x00C4, "\\\"{A}", "A" },                       // Ä
+  { 0x00C5, "\\r{A}", "A" },                        // Å
+  { 0x00C6, "\\AE{}", "AE" },                       // Æ
+  { 0x00C7, "\\c{C}", "C" },                        // Ç
+  { 0x00C8, "\\`{E}", "E" },                        // È
+  { 0x00C9, "\\'{E}", "E" },                        // É
+  { 0x00CA, "\\^{E}", "E" },                        // Ê
+  { 0x00CB, "\\\"{E}", "E" },                       // Ë
+  { 0x00CC, "\\`{I}", "I" },                        // Ì
+  { 0x00CD, "\\'{I}", "I" },                        // Í
+  { 0x00CE, "\\^{I}", "I" },                        // Î
+  { 0x00CF, "\\\"{I}", "I" },                       // Ï
+  { 0x00D0, "\\DH{}", "D" },                        // Ð
+  { 0x00D1, "\\~{N}", "N" },                        // Ñ
+  { 0x00D2, "\\`{O}", "O" },                        // Ò
+  { 0x00D3, "\\'{O}", "O" },                        // Ó
+  { 0x00D4, "\\^{O}", "O" },                        // Ô
+  { 0x00D5, "\\~{O}", "O" },                        // Õ
+  { 0x00D6, "\\\"{O}", "O" },                       // Ö
+  { 0x00D7, "$\\times$", "x" },                     // ×
+  { 0x00D8, "\\O{}", "O" },                         // Ø
+  { 0x00D9, "\\`{U}", "U" },                        // Ù
+  { 0x00DA, "\\'{U}", "U" },                        // Ú
+  { 0x00DB, "\\^{U}", "U" },                        // Û
+  { 0x00DC, "\\\"{U}", "U" },                       // Ü
+  { 0x00DD, "\\'{Y}", "Y" },                        // Ý
+  { 0x00DE, "\\TH{}", "Th" },                       // Þ
+  { 0x00DF, "\\ss{}", "ss" },                       // ß
+  { 0x00E0, "\\`{a}", "a" },                        // à
+  { 0x00E1, "\\'{a}", "a" },                        // á
+  { 0x00E2, "\\^{a}", "a" },                        // â
+  { 0x00E3, "\\~{a}", "a" },                        // ã
+  { 0x00E4, "\\\"{a}", "a" },                       // ä
+  { 0x00E5, "\\r{a}", "a" },                        // å
+  { 0x00E6, "\\ae{}", "ae" },                       // æ
+  { 0x00E7, "\\c{c}", "c" },                        // ç
+  { 0x00E8, "\\`{e}", "e" },                        // è
+  { 0x00E9, "\\'{e}", "e" },                        // é
+  { 0x00EA, "\\^{e}", "e" },                        // ê
+  { 0x00EB, "\\\"{e}", "e" },                       // ë
+  { 0x00EC, "\\`{i}", "i" },                        // ì
+  { 0x00ED, "\\'{i}", "i" },                        // í
+  { 0x00EE, "\\^{i}", "i" },                        // î
+  { 0x00EF, "\\\"{i}", "i" },                       // ï
+  { 0x00F0, "\\dh{}", "d" },                        // ð
+  { 0x00F1, "\\~{n}", "n" },                        // ñ
+  { 0x00F2, "\\`{o}", "o" },                        // ò
+  { 0x00F3, "\\'{o}", "o" },                        // ó
+  { 0x00F4, "\\^{o}", "o" },                        // ô
+  { 0x00F5, "\\~{o}", "o" },                        // õ
+  { 0x00F6, "\\\"{o}", "o" },                       // ö
+  { 0x00F7, "$\\div$", "/" },                       // ÷
+  { 0x00F8, "\\o{}", "o" },                         // ø
+  { 0x00F9, "\\`{u}", "u" },                        // ù
+  { 0x00FA, "\\'{u}", "u" },                        // ú
+  { 0x00FB, "\\^{u}", "u" },                        // û
+  { 0x00FC, "\\\"{u}", "u" },                       // ü
+  { 0x00FD, "\\'{y}", "y" },                        // ý
+  { 0x00FE, "\\th{}", "th" },                       // þ
+  { 0x00FF, "\\\"{y}", "y" },                       // ÿ
+  { 0x0152, "\\OE{}", "OE" },                       // Œ
+  { 0x0153, "\\oe{}", "oe" },                       // œ
+  { 0x0160, "\\v{S}", "S" },                        // Š
+  { 0x0161, "\\v{s}", "s" },                        // š
+  { 0x0178, "\\\"{Y}", "Y" },                       // Ÿ
+  { 0x0192, "$f$", "f" },                           // ƒ
+  { 0x02C6, "\\^{}", "^" },                         // ˆ
+  { 0x02DC, "\\~{}", "~" },                         // ˜
+  { 0x0391, "A", "A" },                             // Α
+  { 0x0392, "B", "B" },                             // Β
+  { 0x0393, "$\\Gamma$", "G" },                     // Γ
+  { 0x0394, "$\\Delta$", "D" },                     // Δ
+  { 0x0395, "E", "E" },                             // Ε
+  { 0x0396, "Z", "Z" },                             // Ζ
+  { 0x0397, "H", "E" },                             // Η
+  { 0x0398, "$\\Theta$", "T" },                     // Θ
+  { 0x0399, "I", "I" },                             // Ι
+  { 0x039A, "K", "K" },                             // Κ
+  { 0x039B, "$\\Lambda$", "L" },                    // Λ
+  { 0x039C, "M", "M" },                             // Μ
+  { 0x039D, "N", "N" },                             // Ν
+  { 0x039E, "$\\Xi$", "X" },                        // Ξ
+  { 0x039F, "O", "O" },                             // Ο
+  { 0x03A0, "$\\Pi$", "P" },                        // Π
+  { 0x03A1, "P", "R" },                             // Ρ
+  { 0x03A3, "$\\Sigma$", "S" },                     // Σ
+  { 0x03A4, "T", "T" },                             // Τ
+  { 0x03A5, "$\\Upsilon$", "U" },                   // Υ
+  { 0x03A6, "$\\Phi$", "P" },                       // Φ
+  { 0x03A7, "X", "C" },                             // Χ
+  { 0x03A8, "$\\Psi$", "P" },                       // Ψ
+  { 0x03A9, "$\\Omega$", "O" },                     // Ω
+  { 0x03B1, "$\\alpha$", "a" },                     // α
+  { 0x03B2, "$\\beta$", "b" },                      // β
+  { 0x03B3, "$\\gamma$", "g" },                     // γ
+  { 0x03B4, "$\\delta$", "d" },                     // δ
+  { 0x03B5, "$\\epsilon$", "e" },                   // ε
+  { 0x03B6, "$\\zeta$", "z" },                      // ζ
+  { 0x03B7, "$\\eta$", "e" },                       // η
+  { 0x03B8, "$\\theta$", "t" },                     // θ
+  { 0x03B9, "$\\iota$", "i" },                      // ι
+  { 0x03BA, "$\\kappa$", "k" },                     // κ
+  { 0x03BB, "$\\lambda$", "l" },                    // λ
+  { 0x03BC, "$\\mu$", "m" },                        // μ
+  { 0x03BD, "$\\nu$", "n" },                        // ν
+  { 0x03BE, "$\\xi$", "x" },                        // ξ
+  { 0x03BF, "o", "o" },                             // ο
+  { 0x03C0, "$\\pi$", "p" },                        // π
+  { 0x03C1, "$\\rho$", "r" },                       // ρ
+  { 0x03C2, "$\\varsigma$", "s" },                  // ς
+  { 0x03C3, "$\\sigma$", "s" },                     // σ
+  { 0x03C4, "$\\tau$", "t" },                       // τ
+  { 0x03C5, "$\\upsilon$", "u" },                   // υ
+  { 0x03C6, "$\\phi$", "p" },                       // φ
+  { 0x03C7, "$\\chi$", "c" },                       // χ
+  { 0x03C8, "$\\psi$", "p" },                       // ψ
+  { 0x03C9, "$\\omega$", "o" },                     // ω
+  { 0x03D1, "$\\vartheta$", "t" },                  // ϑ
+  { 0x03D2, "$\\Upsilon$", "Y" },                   // ϒ
+  { 0x03D6, "$\\varpi$", "p" },                     // ϖ
+  { 0x2002, "\\enspace{}", " " },                   // en space
+  { 0x2003, "\\quad{}", " " },                      // em space
+  { 0x2009, "\\,", " " },                           // thin space
+  { 0x200C, "{}", "" },                             // zero width non-joiner
+  { 0x200D, "{}", "" },                             // zero width joiner
+  { 0x200E, "", "" },                               // left-to-right mark
+  { 0x200F, "", "" },                               // right-to-left mark
+  { 0x2013, "--", "-" },                            // –
+  { 0x2014, "---", "--" },                          // —
+  { 0x2018, "`", "'" },                             // ‘
+  { 0x2019, "'", "'" },                             // ’
+  { 0x201A, ",", "," },                             // ‚
+  { 0x201C, "``", "\"" },                           // “
+  { 0x201D, "''", "\"" },                           // ”
+  { 0x201E, ",,", "\"" },                           // „
+  { 0x2020, "\\dag{}", "+" },                       // †
+  { 0x2021, "\\ddag{}", "++" },                     // ‡
+  { 0x2022, "$\\bullet$", "*" },                    // •
+  { 0x2026, "\\ldots{}", "..." },                   // …
+  { 0x2030, "\\textperthousand{}", "%o" },          // ‰
+  { 0x2032, "$'$", "'" },                           // ′
+  { 0x2033, "$''$", "\"" },                         // ″
+  { 0x2039, "\\guilsinglleft{}", "<" },             // ‹
+  { 0x203A, "\\guilsinglright{}", ">" },            // ›
+  { 0x203E, "$\\overline{\\ }$", "-" },             // ‾
+  { 0x2044, "/", "/" },                             // ⁄
+  { 0x20AC, "\\texteuro{}", "EUR" },                // €
+  { 0x2111, "$\\Im$", "Im" },                       // ℑ
+  { 0x2118, "$\\wp$", "P" },                        // ℘
+  { 0x211C, "$\\Re$", "Re" },                       // ℜ
+  { 0x2122, "\\texttrademark{}", "(TM)" },          // ™
+  { 0x2135, "$\\aleph$", "aleph" },                 // ℵ
+  { 0x2190, "$\\leftarrow$", "<-" },                // ←
+  { 0x2191, "$\\uparrow$", "^" },                   // ↑
+  { 0x2192, "$\\rightarrow$", "->" },               // →
+  { 0x2193, "$\\downarrow$", "v" },                 // ↓
+  { 0x2194, "$\\leftrightarrow$", "<->" },          // ↔
+  { 0x21B5, "$\\hookleftarrow$", "<-" },            // ↵
+  { 0x21D0, "$\\Leftarrow$", "<=" },                // ⇐
+  { 0x21D1, "$\\Uparrow$", "^" },                   // ⇑
+  { 0x21D2, "$\\Rightarrow$", "=>" },               // ⇒
+  { 0x21D3, "$\\Downarrow$", "v" },                 // ⇓
+  { 0x21D4, "$\\Leftrightarrow$", "<=>" },          // ⇔
+  { 0x2200, "$\\forall$", "A" },                    // ∀
+  { 0x2202, "$\\partial$", "d" },                   // ∂
+  { 0x2203, "$\\exists$", "E" },                    // ∃
+  { 0x2205, "$\\emptyset$", "{}" },                 // ∅
+  { 0x2207, "$\\nabla$", "V" },                     // ∇
+  { 0x2208, "$\\in$", "in" },                       // ∈
+  { 0x2209, "$\\notin$", "!in" },                   // ∉
+  { 0x220B, "$\\ni$", "ni" },                       // ∋
+  { 0x220F, "$\\prod$", "PI" },                     // ∏
+  { 0x2211, "$\\sum$", "SUM" },                     // ∑
+  { 0x2212, "$-$", "-" },                           // −
+  { 0x2217, "$\\ast$", "*" },                       // ∗
+  { 0x221A, "$\\surd$", "sqrt" },                   // √
+  { 0x221D, "$\\propto$", "~" },                    // ∝
+  { 0x221E, "$\\infty$", "inf" },                   // ∞
+  { 0x2220, "$\\angle$", "<" },                     // ∠
+  { 0x2227, "$\\wedge$", "^" },                     // ∧
+  { 0x2228, "$\\vee$", "v" },                       // ∨
+  { 0x2229, "$\\cap$", "n" },                       // ∩
+  { 0x222A, "$\\cup$", "U" },                       // ∪
+  { 0x222B, "$\\int$", "S" },                       // ∫
+  { 0x2234, "$\\therefore$", ".:" },                // ∴
+  { 0x223C, "$\\sim$", "~" },                       // ∼
+  { 0x2245, "$\\cong$", "~=" },                     // ≅
+  { 0x2248, "$\\approx$", "~~" },                   // ≈
+  { 0x2260, "$\\neq$", "!=" },                      // ≠
+  { 0x2261, "$\\equiv$", "==" },                    // ≡
+  { 0x2264, "$\\leq$", "<=" },                      // ≤
+  { 0x2265, "$\\geq$", ">=" },                      // ≥
+  { 0x2282, "$\\subset$", "<" },                    // ⊂
+  { 0x2283, "$\\supset$", ">" },                    // ⊃
+  { 0x2284, "$\\not\\subset$", "!<" },              // ⊄
+  { 0x2286, "$\\subseteq$", "<=" },                 // ⊆
+  { 0x2287, "$\\supseteq$", ">=" },                 // ⊇
+  { 0x2295, "$\\oplus$", "(+)" },                   // ⊕
+  { 0x2297, "$\\otimes$", "(x)" },                  // ⊗
+  { 0x22A5, "$\\perp$", "_|_" },                    // ⊥
+  { 0x22C5, "$\\cdot$", "." },                      // ⋅
+  { 0x2308, "$\\lceil$", "[" },                     // ⌈
+  { 0x2309, "$\\rceil$", "]" },                     // ⌉
+  { 0x230A, "$\\lfloor$", "[" },                    // ⌊
+  { 0x230B, "$\\rfloor$", "]" },                    // ⌋
+  { 0x2329, "$\\langle$", "<" },                    // 〈
+  { 0x232A, "$\\rangle$", ">" },                    // 〉
+  { 0x25CA, "$\\lozenge$", "<>" },                  // ◊
+  { 0x2660, "$\\spadesuit$", "S" },                 // ♠
+  { 0x2663, "$\\clubsuit$", "C" },                  // ♣
+  { 0x2665, "$\\heartsuit$", "H" },                 // ♥
+  { 0x2666, "$\\diamondsuit$", "D" },               // ♦
+};
+
+namespace symbols {
+  static constexpr size_t NUM_SYMBOLS = std::size(symbol_table);
+  static constexpr uint16_t NONE = static_cast<uint16_t>(-1);
+
+  static constexpr bool IsSorted() {
+    for (size_t i = 1; i < NUM_SYMBOLS; ++i) {
+      if (symbol_table[i-1].codepoint >= symbol_table[i].codepoint) return false;
+    }
+    return true;
+  }
+  static_assert(IsSorted(), "symbol_table must be sorted by code point with no duplicates.");
+
+  // Most symbols in question banks are Latin-1 or Greek, so give those a direct index.
+  static constexpr uint32_t DENSE_START = 0x80;
+  static constexpr uint32_t DENSE_END = 0x400;
+  static constexpr std::array<uint16_t, DENSE_END - DENSE_START> MakeDenseIndex() {
+    std::array<uint16_t, DENSE_END - DENSE_START> index{};
+    for (auto & id : index) id = NONE;
+    for (size_t i = 0; i < NUM_SYMBOLS; ++i) {
+      const uint32_t codepoint = symbol_table[i].codepoint;
+      if (codepoint >= DENSE_START && codepoint < DENSE_END) {
+        index[codepoint - DENSE_START] = static_cast<uint16_t>(i);
+      }
+    }
+    return index;
+  }
+  static constexpr auto dense_index = MakeDenseIndex();
+}
+
+/// Find the details for a symbol; returns nullptr if it is not in the table.
+static constexpr const SymbolInfo * FindSymbol(uint32_t codepoint) {
+  if (codepoint >= symbols::DENSE_START && codepoint < symbols::DENSE_END) {
+    const uint16_t id = symbols::dense_index[codepoint - symbols::DENSE_START];
+    return (id == symbols::NONE) ? nullptr : &symbol_table[id];
+  }
+  auto it = std::lower_bound(std::begin(symbol_table), std::end(symbol_table), codepoint,
+    [](const SymbolInfo & symbol, uint32_t target){ return symbol.codepoint < target; });
+  return (it != std::end(symbol_table) && it->codepoint == codepoint) ? it : nullptr;
+}
+
+static_assert(FindSymbol(0x03A9)->latex == "$\\Omega$");
+static_assert(FindSymbol(0x2192)->raw == "->");
+static_assert(FindSymbol(0x4E00) == nullptr);
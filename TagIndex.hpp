@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+
+#include "emp/base/Ptr.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/bits/BitVector.hpp"
+#include "emp/tools/String.hpp"
+
+#include "Question.hpp"
+#include "TagSet.hpp"
+
+using emp::String;
+
+// An index from tags to the questions in a bank that have them, kept up to date as the bank
+// is edited rather than rebuilt.  Tag names are interned once; each tag has a bit vector of
+// the question slots that have it, and of the slots exclusive (^) on it.  Build() indexes a
+// whole bank; Splice() replaces a run of questions (e.g., those from one reloaded file),
+// matching old and new by Question::GetIdentityHash().  Unchanged questions keep their slots
+// untouched, edited ones only have the bits for added or removed tags flipped, and questions
+// added or removed get new slots or leave tombstones, so an edit costs time in proportion to
+// the tags on the questions involved.  Once a quarter of the slots are tombstones, the index
+// is compacted.
+class TagIndex {
+private:
+  struct Slot {
+    emp::vector<size_t> tags;     ///< Every tag the question matches with HasTag (sorted IDs).
+    emp::vector<size_t> groups;   ///< Tags the question is exclusive on (sorted IDs).
+    uint64_t identity = 0;        ///< Identity hash of the question in this slot.
+    size_t pos = 0;               ///< Position of the question in the bank.
+    bool live = true;             ///< False once the question is removed (a tombstone).
+  };
+
+  std::map<String, size_t> tag_ids;          ///< Interned tag names.
+  emp::vector<String> tag_names;             ///< Name of each tag, by ID.
+  emp::vector<emp::BitVector> tag_slots;     ///< Slots with each tag (missing bits are 0).
+  emp::vector<emp::BitVector> group_slots;   ///< Slots exclusive on each tag.
+  emp::vector<Slot> slots;
+  emp::vector<size_t> pos_slots;             ///< Slot for the question at each bank position.
+  size_t tombstone_count = 0;
+  bool in_order = true;                      ///< Is each question in the slot at its position?
+  size_t reindex_count = 0;                  ///< Questions (re)indexed since construction.
+  size_t compact_count = 0;
+
+  size_t _GetTagID(const String & name) {
+    auto [it, is_new] = tag_ids.try_emplace(name, tag_names.size());
+    if (is_new) {
+      tag_names.push_back(name);
+      tag_slots.emplace_back();
+      group_slots.emplace_back();
+    }
+    return it->second;
+  }
+
+  Slot _MakeSlot(const Question & q, uint64_t identity) {
+    Slot slot;
+    auto add_tags = [this, &slot](const TagSet & tag_set){
+      for (const String & tag : tag_set.GetBaseTags()) slot.tags.push_back(_GetTagID(tag));
+      for (const String & tag : tag_set.GetExclusiveTags()) {
+        slot.tags.push_back(_GetTagID(tag));
+        slot.groups.push_back(_GetTagID(tag));
+      }
+      for (const auto & [name, value] : tag_set.GetConfigTags()) {
+        slot.tags.push_back(_GetTagID(name));
+      }
+    };
+    add_tags(q.GetOwnTags());
+    for (auto tag_set : q.GetSharedTags()) add_tags(*tag_set);
+    for (emp::vector<size_t> * ids : {&slot.tags, &slot.groups}) {
+      std::sort(ids->begin(), ids->end());
+      ids->erase(std::unique(ids->begin(), ids->end()), ids->end());
+    }
+    slot.identity = identity;
+    return slot;
+  }
+
+  static void _SetBits(emp::vector<emp::BitVector> & bit_sets, const emp::vector<size_t> & ids,
+                       size_t slot_id, bool value) {
+    for (size_t id : ids) {
+      emp::BitVector & bits = bit_sets[id];
+      if (slot_id >= bits.GetSize()) {
+        if (!value) continue;
+        bits.Resize(std::max(slot_id + 1, bits.GetSize() * 2));
+      }
+      bits.Set(slot_id, value);
+    }
+  }
+
+  void _Mark(size_t slot_id, bool value) {
+    _SetBits(tag_slots, slots[slot_id].tags, slot_id, value);
+    _SetBits(group_slots, slots[slot_id].groups, slot_id, value);
+  }
+
+  size_t _Insert(Slot && slot) {
+    slots.push_back(std::move(slot));
+    _Mark(slots.size() - 1, true);
+    return slots.size() - 1;
+  }
+
+  // Give a slot new tags, flipping only the bits for tags that were added or removed.
+  void _Update(size_t slot_id, Slot && new_slot) {
+    Slot & slot = slots[slot_id];
+    auto update = [slot_id](emp::vector<emp::BitVector> & bit_sets,
+                            emp::vector<size_t> & old_ids, emp::vector<size_t> & new_ids){
+      emp::vector<size_t> removed, added;
+      std::set_difference(old_ids.begin(), old_ids.end(), new_ids.begin(), new_ids.end(),
+                          std::back_inserter(removed));
+      std::set_difference(new_ids.begin(), new_ids.end(), old_ids.begin(), old_ids.end(),
+                          std::back_inserter(added));
+      _SetBits(bit_sets, removed, slot_id, false);
+      _SetBits(bit_sets, added, slot_id, true);
+      old_ids = std::move(new_ids);
+    };
+    update(tag_slots, slot.tags, new_slot.tags);
+    update(group_slots, slot.groups, new_slot.groups);
+    slot.identity = new_slot.identity;
+  }
+
+  void _Remove(size_t slot_id) {
+    _Mark(slot_id, false);
+    slots[slot_id] = Slot{};
+    slots[slot_id].live = false;
+    ++tombstone_count;
+  }
+
+  emp::BitVector _ToPositions(const emp::vector<emp::BitVector> & bit_sets,
+                              const String & tag) const {
+    emp::BitVector out(pos_slots.size());
+    auto it = tag_ids.find(tag);
+    if (it == tag_ids.end()) return out;
+    const emp::BitVector & bits = bit_sets[it->second];
+    if (in_order) {                // Slots are positions; tombstones are all past the end.
+      out = bits;
+      out.Resize(pos_slots.size());
+      return out;
+    }
+    for (int slot_id = bits.FindOne(); slot_id >= 0;
+         slot_id = bits.FindOne(static_cast<size_t>(slot_id) + 1)) {
+      out.Set(slots[static_cast<size_t>(slot_id)].pos);
+    }
+    return out;
+  }
+
+public:
+  size_t GetSize() const { return pos_slots.size(); }
+  size_t GetSlotCount() const { return slots.size(); }
+  size_t GetTombstoneCount() const { return tombstone_count; }
+  size_t GetTagCount() const { return tag_names.size(); }
+  size_t GetReindexCount() const { return reindex_count; }
+  size_t GetCompactCount() const { return compact_count; }
+
+  /// Approximate memory used by the index, in bytes.
+  size_t GetMemoryBytes() const {
+    size_t bytes = pos_slots.size() * sizeof(size_t) + slots.size() * sizeof(Slot);
+    for (const Slot & slot : slots) {
+      bytes += (slot.tags.size() + slot.groups.size()) * sizeof(size_t);
+    }
+    for (size_t id = 0; id < tag_names.size(); ++id) {
+      bytes += 2 * sizeof(String) + 2 * tag_names[id].size();
+      bytes += (tag_slots[id].GetSize() + group_slots[id].GetSize()) / 8;
+    }
+    return bytes;
+  }
+
+  /// Index the questions now in a bank, replacing anything indexed before.
+  void Build(const emp::vector<emp::Ptr<Question>> & questions) {
+    tag_ids.clear();
+    tag_names.clear();
+    tag_slots.clear();
+    group_slots.clear();
+    slots.clear();
+    pos_slots.resize(questions.size());
+    for (size_t pos = 0; pos < questions.size(); ++pos) {
+      pos_slots[pos] = _Insert(_MakeSlot(*questions[pos], questions[pos]->GetIdentityHash()));
+      slots[pos].pos = pos;
+    }
+    tombstone_count = 0;
+    in_order = true;
+    reindex_count += questions.size();
+  }
+
+  /// The old_count questions indexed from position `start` have been replaced by the
+  /// new_count questions now there in the bank; bring the index up to date.  Questions are
+  /// matched by identity, so only those added, removed, or changed are reindexed (an edited
+  /// question reuses the slot of one removed).  Returns the number of questions reindexed.
+  size_t Splice(const emp::vector<emp::Ptr<Question>> & questions, size_t start,
+                size_t old_count, size_t new_count) {
+    std::multimap<uint64_t, size_t> old_slots;   // Identity -> slot of each question replaced
+    for (size_t pos = start; pos < start + old_count; ++pos) {
+      old_slots.emplace(slots[pos_slots[pos]].identity, pos_slots[pos]);
+    }
+
+    // Keep the slot of each question that is unchanged; the rest must be reindexed.
+    emp::vector<size_t> new_slot_ids(new_count, slots.size());
+    emp::vector<uint64_t> identities(new_count);
+    for (size_t i = 0; i < new_count; ++i) {
+      identities[i] = questions[start + i]->GetIdentityHash();
+      auto it = old_slots.find(identities[i]);
+      if (it == old_slots.end()) continue;
+      new_slot_ids[i] = it->second;
+      old_slots.erase(it);
+    }
+    const size_t start_count = reindex_count;
+    auto unused = old_slots.begin();
+    for (size_t i = 0; i < new_count; ++i) {
+      if (new_slot_ids[i] < slots.size()) continue;
+      Slot slot = _MakeSlot(*questions[start + i], identities[i]);
+      if (unused != old_slots.end()) {
+        new_slot_ids[i] = unused->second;
+        _Update(unused->second, std::move(slot));
+        unused = old_slots.erase(unused);
+      }
+      else new_slot_ids[i] = _Insert(std::move(slot));
+      ++reindex_count;
+    }
+    for (; unused != old_slots.end(); ++unused, ++reindex_count) _Remove(unused->second);
+
+    // Questions after the replaced ones keep their slots, but may have moved.
+    pos_slots.erase(pos_slots.begin() + static_cast<std::ptrdiff_t>(start),
+                    pos_slots.begin() + static_cast<std::ptrdiff_t>(start + old_count));
+    pos_slots.insert(pos_slots.begin() + static_cast<std::ptrdiff_t>(start),
+                     new_slot_ids.begin(), new_slot_ids.end());
+    const size_t end_pos = (old_count == new_count) ? start + new_count : pos_slots.size();
+    for (size_t pos = start; pos < end_pos; ++pos) {
+      slots[pos_slots[pos]].pos = pos;
+      in_order &= pos_slots[pos] == pos;
+    }
+    if (tombstone_count * 4 > slots.size()) Compact();
+    return reindex_count - start_count;
+  }
+
+  /// Renumber the slots to match bank positions, dropping all tombstones.  Every bit vector
+  /// is rebuilt, so this is only done once tombstones build up.
+  void Compact() {
+    emp::vector<Slot> new_slots;
+    new_slots.reserve(pos_slots.size());
+    for (size_t slot_id : pos_slots) new_slots.push_back(std::move(slots[slot_id]));
+    slots = std::move(new_slots);
+    for (auto & bits : tag_slots) bits = emp::BitVector(slots.size());
+    for (auto & bits : group_slots) bits = emp::BitVector(slots.size());
+    for (size_t pos = 0; pos < slots.size(); ++pos) {
+      pos_slots[pos] = pos;
+      slots[pos].pos = pos;
+      _Mark(pos, true);
+    }
+    tombstone_count = 0;
+    in_order = true;
+    ++compact_count;
+  }
+
+  /// Positions of the questions with the provided tag (as found by Question::HasTag).
+  emp::BitVector GetMatches(const String & tag) const { return _ToPositions(tag_slots, tag); }
+
+  /// Positions of the questions exclusive (^) on the provided tag.
+  emp::BitVector GetGroup(const String & tag) const { return _ToPositions(group_slots, tag); }
+
+  /// Every tag that at least one question is exclusive on.
+  emp::vector<String> GetGroupTags() const {
+    emp::vector<String> out;
+    for (size_t id = 0; id < tag_names.size(); ++id) {
+      if (group_slots[id].Any()) out.push_back(tag_names[id]);
+    }
+    return out;
+  }
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <map>
+
+#include "emp/base/vector.hpp"
+#include "emp/datastructs/map_utils.hpp"
+#include "emp/datastructs/vector_utils.hpp"
+#include "emp/tools/String.hpp"
+
+#include "Hash.hpp"
+
+using emp::String;
+
+// A pre-parsed collection of tags: regular (#), exclusive (^), and config (:name=value).
+// Tag sets are parsed once and can then be shared by any number of questions.
+class TagSet {
+private:
+  emp::vector<String> base_tags;       ///< Tags to identify topic.
+  emp::vector<String> exclusive_tags;  ///< Tags for question groups where only one should be used.
+  std::map<String,String> config_tags; ///< Tags to specify question details (num options, etc)
+
+public:
+  TagSet() { }
+  TagSet(const TagSet &) = default;
+  TagSet(TagSet &&) = default;
+
+  TagSet & operator=(const TagSet &) = default;
+  TagSet & operator=(TagSet &&) = default;
+
+  /// Parse a line of tags, calling error_fun with a description of any malformed tag.
+  template <typename ERROR_FUN>
+  void AddTags(String line, ERROR_FUN && error_fun) {
+    line.Compress();
+    auto tags = line.Slice(" ");
+    for (auto tag : tags) {
+      if (tag[0] == '#') base_tags.push_back(tag);
+      else if (tag[0] == '^') exclusive_tags.push_back(tag);
+      else if (tag[0] == ':') {
+        if (!tag.Has('=')) { error_fun("Tag '", tag, "' must have an assignment."); continue; }
+        String name = tag.Pop('=');
+        if (tag.size() == 0) error_fun("Tag '", name, "' must have value after '='.");
+        config_tags[name] = tag;
+      }
+      else {
+        error_fun("Unknown tag type '", tag, "'.");
+      }
+    }
+  }
+
+  /// Add a single tag that has already been parsed; the type comes from its first character.
+  void AddTag(const String & name, const String & value="") {
+    if (name.empty()) return;
+    if (name[0] == '#') base_tags.push_back(name);
+    else if (name[0] == '^') exclusive_tags.push_back(name);
+    else if (name[0] == ':') config_tags[name] = value;
+  }
+
+  bool IsEmpty() const {
+    return base_tags.empty() && exclusive_tags.empty() && config_tags.empty();
+  }
+
+  const emp::vector<String> & GetBaseTags() const { return base_tags; }
+  const emp::vector<String> & GetExclusiveTags() const { return exclusive_tags; }
+  const std::map<String,String> & GetConfigTags() const { return config_tags; }
+
+  bool HasTag(const String & tag) const {
+    return emp::Has(base_tags, tag) || emp::Has(exclusive_tags, tag) || emp::Has(config_tags, tag);
+  }
+
+  void AddToHash(Hasher & hasher) const {
+    hasher.Add(base_tags.size(), exclusive_tags.size(), config_tags.size());
+    for (const String & tag : base_tags) hasher.Add(tag);
+    for (const String & tag : exclusive_tags) hasher.Add(tag);
+    for (const auto & [name, value] : config_tags) hasher.Add(name, value);
+  }
+
+  /// Return a pointer to the value of a config tag, or nullptr if it is not set here.
+  const String * FindConfig(const String & name) const {
+    auto it = config_tags.find(name);
+    return (it == config_tags.end()) ? nullptr : &it->second;
+  }
+};
@@ -0,0 +1,334 @@
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "emp/base/notify.hpp"
+#include "emp/base/vector.hpp"
+#include "emp/tools/String.hpp"
+
+#include "Hash.hpp"
+
+using emp::String;
+
+// Templates for the text that surrounds questions in the output: document headers and
+// footers, and a wrapper around each question.  Each template is compiled once (when QBL
+// starts) into a sequence of literal segments and typed slots, so rendering is just a loop of
+// appends.  Slots are written {{name}}; only the names below are slots, so any other use of
+// braces (as in LaTeX or JavaScript) is copied through unchanged.
+//   {{title}}  Exam title (-t)                 {{q_num}}  Question number (from 1)
+//   {{base}}   Output filename, no extension   {{id}}     Question ID in the bank
+//   {{body}}   Rendered question (wrappers only)
+class OutputTemplate {
+public:
+  enum class Slot { LITERAL=0, TITLE, BASE, Q_NUM, ID, BODY };
+
+  /// Values to fill the slots with; views must remain valid while rendering.
+  struct Values {
+    std::string_view title = "";
+    std::string_view base = "";
+    std::string_view body = "";
+    size_t q_num = 0;
+    size_t id = 0;
+  };
+
+private:
+  struct Segment {
+    Slot slot;
+    size_t start = 0;     ///< Position of a literal in `text`.
+    size_t length = 0;    ///< Length of a literal.
+  };
+
+  std::string text;                ///< Template source; literals are ranges within it.
+  emp::vector<Segment> segments;
+
+  static Slot _FindSlot(std::string_view name) {
+    constexpr std::array<std::pair<std::string_view, Slot>, 5> slot_names{{
+      {"title", Slot::TITLE}, {"base", Slot::BASE}, {"q_num", Slot::Q_NUM},
+      {"id", Slot::ID}, {"body", Slot::BODY}
+    }};
+    for (const auto & [slot_name, slot] : slot_names) if (slot_name == name) return slot;
+    return Slot::LITERAL;
+  }
+
+  void _AddLiteral(size_t start, size_t end) {
+    if (end <= start) return;
+    if (segments.size() && segments.back().slot == Slot::LITERAL &&
+        segments.back().start + segments.back().length == start) {
+      segments.back().length += end - start;    // Extend the previous literal.
+    }
+    else segments.push_back(Segment{Slot::LITERAL, start, end - start});
+  }
+
+  void _Compile() {
+    segments.clear();
+    size_t literal_start = 0, pos = 0;
+    while ((pos = text.find("{{", pos)) != std::string::npos) {
+      const size_t end = text.find("}}", pos + 2);
+      if (end == std::string::npos) break;
+      const Slot slot = _FindSlot(std::string_view(text).substr(pos + 2, end - pos - 2));
+      if (slot == Slot::LITERAL) { ++pos; continue; }    // Not a slot; keep as text.
+      _AddLiteral(literal_start, pos);
+      segments.push_back(Segment{slot});
+      pos = literal_start = end + 2;
+    }
+    _AddLiteral(literal_start, text.size());
+  }
+
+public:
+  OutputTemplate(std::string in_text="") : text(std::move(in_text)) { _Compile(); }
+
+  const std::string & GetText() const { return text; }
+  bool IsEmpty() const { return segments.empty(); }
+
+  /// Is this a wrapper that leaves the question unchanged?
+  bool IsPassThrough() const { return segments.size() == 1 && segments[0].slot == Slot::BODY; }
+
+  void Render(std::ostream & os, const Values & values) const {
+    for (const Segment & segment : segments) {
+      switch (segment.slot) {
+        case Slot::LITERAL:
+          os.write(text.data() + segment.start, static_cast<std::streamsize>(segment.length));
+          break;
+        case Slot::TITLE:   os << values.title; break;
+        case Slot::BASE:    os << values.base; break;
+        case Slot::Q_NUM:   os << values.q_num; break;
+        case Slot::ID:      os << values.id; break;
+        case Slot::BODY:    os << values.body; break;
+      }
+    }
+  }
+};
+
+// Built-in templates; these reproduce QBL's standard output.
+static constexpr std::pair<std::string_view, std::string_view> default_templates[] = {
+  { "html_header",
+    "<!DOCTYPE html>\n"
+    "<html lang=\"en\">\n"
+    "<head>\n"
+    "  <meta charset=\"UTF-8\">\n"
+    "  <meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">\n"
+    "  <title>{{title}}</title>\n"
+    "  <link rel=\"stylesheet\" href=\"{{base}}.css\">\n"
+    "</head>\n"
+    "<body>\n"
+    "\n"
+    "<form id=\"quizForm\">\n"
+    "  <h1>{{title}}</h1>\n"
+    "\n" },
+  { "html_footer",
+    "  <hr><p>\n"
+    "  Click <b>Check Answers</b> to identify any errors and try again.  Click <b>Show Answers</b> if you also want to know which answer is the correct one.\n"
+    "  </p>\n"
+    "  <button type=\"button\" id=\"checkAnswersBtn\">Check Answers</button>\n"
+    "  <button type=\"button\" id=\"showAnswersBtn\">Show Answers</button>\n"
+    "</form>\n"
+    "<div id=\"results\"></div>\n"
+    "<script src=\"{{base}}.js\"></script>\n"
+    "</body>\n"
+    "</html>\n" },
+  { "js_header",
+    "// Fetch all the radio buttons in the quiz\n"
+    "let radioButtons = document.querySelectorAll('input[type=\"radio\"]');\n"
+    "\n"
+    "// Add a click event to each radio button\n"
+    "radioButtons.forEach(button => {\n"
+    "  button.addEventListener('click', function() { clearResults(button.name); });\n"
+    "});\n"
+    "\n"
+    "function clearResults(button_name) {\n"
+    "  // Clear main results\n"
+    "  document.getElementById('results').innerHTML = '';\n"
+    "\n"
+    "  // Clear answers displayed beneath each question\n"
+    "  let answerDiv = document.querySelector(`.answer[data-question=\"${button_name}\"]`);\n"
+    "  answerDiv.innerHTML = \"\";\n"
+    "}\n"
+    "\n"
+    "function PrintResults(show_correct) {"
+    "  event.preventDefault(); // Prevent form from submitting to a server\n"
+    "  let correctAnswers = {\n" },
+  { "js_footer",
+    "  };\n"
+    "\n"
+    "  let userAnswers = {};\n"
+    "  for (let key in correctAnswers) {\n"
+    "    let selectedAnswer = document.querySelector(`input[name=\"${key}\"]:checked`);\n"
+    "    userAnswers[key] = selectedAnswer ? selectedAnswer.value : \"\";\n"
+    "  }\n"
+    "\n"
+    "  let score = 0;\n"
+    "  let results = [];\n"
+    "\n"
+    "  for (let key in correctAnswers) {\n"
+    "    if (userAnswers[key] === correctAnswers[key]) {\n"
+    "      score++;\n"
+    "      results.push({\n"
+    "        question: key,\n"
+    "        status: 1,\n"
+    "        correctAnswer: correctAnswers[key]\n"
+    "      });\n"
+    "    } else {\n"
+    "      results.push({\n"
+    "        question: key,\n"
+    "        status: 0,\n"
+    "        correctAnswer: correctAnswers[key]\n"
+    "      });\n"
+    "    }\n"
+    "  }\n"
+    "\n"
+    "  displayResults(score, results, show_correct);\n"
+    "};\n"
+    "\n"
+    "function displayResults(score, results, show_correct) {\n"
+    "  let resultsDiv = document.getElementById('results');\n"
+    "  resultsDiv.innerHTML = `<p>You got ${score} out of ${Object.keys(results).length} correct!</p>`;\n"
+    "\n"
+    "  // Reset all answer texts\n"
+    "  let answerDivs = document.querySelectorAll('.answer');\n"
+    "  answerDivs.forEach(div => div.innerHTML = \"\");\n"
+    "\n"
+    "  results.forEach(item => {\n"
+    "    let answerDiv = document.querySelector(`.answer[data-question=\"${item.question}\"]`);\n"
+    "    if (item.status === 0) {\n"
+    "      if (show_correct) {\n"
+    "        answerDiv.innerHTML = `<b>Incorrect</b>. The correct answer is: ${item.correctAnswer}`;\n"
+    "      } else {\n"
+    "        answerDiv.innerHTML = `<b>Incorrect</b>.`;\n"
+    "      }\n"
+    "      answerDiv.style.color = \"red\";\n"
+    "    } else {\n"
+    "      answerDiv.innerHTML = `<b>Correct!</b>`;\n"
+    "      answerDiv.style.color = \"green\";\n"
+    "    }\n"
+    "  });\n"
+    "};\n"
+    "\n"
+    "document.getElementById('showAnswersBtn').addEventListener('click', function() {\n"
+//    "document.getElementById('quizForm').addEventListener('submit', function(event) {\n"
+    "  PrintResults(1);\n"
+    "});\n"
+    "\n"
+    "document.getElementById('checkAnswersBtn').addEventListener('click', function() {\n"
+    "  PrintResults(0);\n"
+    "});\n" },
+  { "css",
+    "body {\n"
+    "  font-family: Arial, sans-serif;\n"
+    "  margin: 50px;\n"
+    "}\n"
+    "\n"
+    ".question {\n"
+    "  margin-bottom: 20px;\n"
+    "  color: black;\n"
+    "}\n"
+    ".options {\n"
+    "  color: #000088;\n"
+    "}\n"
+    "\n"
+    "label {\n"
+    "  display: block;\n"
+    "  margin-bottom: 5px;\n"
+    "}\n"
+    "\n"
+    "input[type=\"submit\"] {\n"
+    "  padding: 10px 15px;\n"
+    "  background-color: #007BFF;\n"
+    "  color: white;\n"
+    "  border: none;\n"
+    "  cursor: pointer;\n"
+    "}\n"
+    "\n"
+    "input[type=\"submit\"]:hover {\n"
+    "  background-color: #0056b3;\n"
+    "}\n" },
+  { "latex_header", "" },
+  { "latex_question", "{{body}}" },
+  { "latex_footer", "" },
+  { "gradescope_header", "" },
+  { "gradescope_question", "{{body}}" },
+  { "gradescope_footer", "" },
+  { "html_question", "{{body}}" },
+  { "js_question", "{{body}}" },
+};
+
+// The full set of templates in use: the built-in ones, replaced by any the user provides.
+class TemplateSet {
+public:
+  struct Override {
+    String filename;    ///< File the template was loaded from.
+    uint64_t hash;      ///< Hash of the template text when it was loaded.
+  };
+
+private:
+  std::map<String, OutputTemplate> templates;
+  std::map<String, Override> overrides;     ///< Templates replaced by the user, by name.
+
+public:
+  TemplateSet() {
+    for (const auto & [name, text] : default_templates) {
+      templates.emplace(String(std::string(name)), OutputTemplate(std::string(text)));
+    }
+  }
+
+  static String GetNames() {
+    String names;
+    for (const auto & [name, text] : default_templates) {
+      names.Append(names.size() ? ", " : "", std::string(name));
+    }
+    return names;
+  }
+
+  /// Replace a template from a "name=filename" argument; returns false if it cannot be used.
+  bool Load(const String & arg) {
+    const size_t eq_pos = arg.find('=');
+    const String name = arg.substr(0, eq_pos);
+    if (eq_pos == String::npos || !templates.contains(name)) {
+      emp::notify::Error("Unknown template '", name, "' (use name=file); templates are: ",
+                         GetNames(), ".");
+      return false;
+    }
+    const String filename = arg.substr(eq_pos + 1);
+    std::ifstream file(filename.str(), std::ios::binary);
+    if (!file) {
+      emp::notify::Error("Unable to open template file '", filename, "'.");
+      return false;
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    const std::string text = ss.str();
+    templates[name] = OutputTemplate(text);
+    overrides[name] = Override{filename, HashValues(std::string_view(text))};
+    return true;
+  }
+
+  const OutputTemplate & Get(const String & name) const { return templates.at(name); }
+  const std::map<String, Override> & GetOverrides() const { return overrides; }
+
+  /// The wrapper for each question of an output format, or nullptr if it changes nothing.
+  const OutputTemplate * GetWrapper(std::string_view format) const {
+    format = format.substr(0, format.find('-'));    // Variants share one template.
+    auto it = templates.find(String(std::string(format) + "_question"));
+    if (it == templates.end() || it->second.IsPassThrough()) return nullptr;
+    return &it->second;
+  }
+
+  /// Print a question inside the wrapper for its output format, if that format has one.  The
+  /// question itself is printed by print_fun(os); values provide everything but its body.
+  template <typename PRINT_FUN>
+  void PrintWrapped(std::ostream & os, std::string_view format, OutputTemplate::Values values,
+                    PRINT_FUN && print_fun) const {
+    const OutputTemplate * wrapper = GetWrapper(format);
+    if (!wrapper) { print_fun(os); return; }
+    std::stringstream body;
+    print_fun(body);
+    const std::string body_text = body.str();
+    values.body = body_text;
+    wrapper->Render(os, values);
+  }
+};
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// A table-driven UTF-8 decoder (a DFA in the style of Bjoern Hoehrmann's decoder).  Each byte
+// is mapped to a character class, and (state, class) pairs map to the next state; the tables
+// are built at compile time from the ranges in the Unicode standard.  Overlong encodings,
+// surrogates, and code points past U+10FFFF are all rejected.
+
+namespace utf8 {
+  static constexpr uint8_t ACCEPT = 0;   ///< A full code point has been decoded.
+  static constexpr uint8_t REJECT = 1;   ///< The input is not valid UTF-8.
+
+  // Byte classes (the low bits also mask off the length marker of a lead byte; see Step()).
+  static constexpr std::array<uint8_t, 256> MakeByteClasses() {
+    std::array<uint8_t, 256> classes{};
+    for (size_t i = 0x00; i <= 0x7F; ++i) classes[i] = 0;    // ASCII
+    for (size_t i = 0x80; i <= 0x8F; ++i) classes[i] = 1;    // Continuation bytes...
+    for (size_t i = 0x90; i <= 0x9F; ++i) classes[i] = 9;
+    for (size_t i = 0xA0; i <= 0xBF; ++i) classes[i] = 7;
+    classes[0xC0] = classes[0xC1] = 8;                       // Always overlong.
+    for (size_t i = 0xC2; i <= 0xDF; ++i) classes[i] = 2;    // Two-byte lead.
+    classes[0xE0] = 10;                                      // Three-byte lead (limited)
+    for (size_t i = 0xE1; i <= 0xEF; ++i) classes[i] = 3;    // Three-byte lead.
+    classes[0xED] = 4;                                       // Three-byte lead (no surrogates)
+    classes[0xF0] = 11;                                      // Four-byte lead (limited)
+    for (size_t i = 0xF1; i <= 0xF3; ++i) classes[i] = 6;    // Four-byte lead.
+    classes[0xF4] = 5;                                       // Four-byte lead (max U+10FFFF)
+    for (size_t i = 0xF5; i <= 0xFF; ++i) classes[i] = 8;    // Never valid.
+    return classes;
+  }
+
+  // States: 0=accept, 1=reject, 2-8 = partway through a multi-byte sequence.
+  static constexpr size_t NUM_STATES = 9;
+  static constexpr size_t NUM_CLASSES = 12;
+  static constexpr std::array<uint8_t, NUM_STATES * NUM_CLASSES> MakeTransitions() {
+    std::array<uint8_t, NUM_STATES * NUM_CLASSES> next{};
+    for (auto & state : next) state = REJECT;
+    auto set = [&next](size_t state, size_t byte_class, uint8_t target) {
+      next[state * NUM_CLASSES + byte_class] = target;
+    };
+    set(0, 0, ACCEPT);  set(0, 2, 2);  set(0, 3, 3);  set(0, 10, 4);
+    set(0, 4, 5);       set(0, 11, 6); set(0, 6, 7);  set(0, 5, 8);
+    for (size_t c : {1, 7, 9}) { set(2, c, ACCEPT); set(3, c, 2); set(7, c, 3); }
+    set(4, 7, 2);                  // After E0: A0-BF only.
+    set(5, 1, 2);  set(5, 9, 2);   // After ED: 80-9F only.
+    set(6, 7, 3);  set(6, 9, 3);   // After F0: 90-BF only.
+    set(8, 1, 3);                  // After F4: 80-8F only.
+    return next;
+  }
+
+  static constexpr std::array<uint8_t, 256> byte_classes = MakeByteClasses();
+  static constexpr std::array<uint8_t, NUM_STATES * NUM_CLASSES> transitions = MakeTransitions();
+
+  /// Feed one byte into the decoder; returns the new state.  When it returns ACCEPT, codepoint
+  /// holds the fully decoded character.
+  static constexpr uint8_t Step(uint8_t state, uint32_t & codepoint, uint8_t byte) {
+    const uint8_t byte_class = byte_classes[byte];
+    codepoint = (state != ACCEPT) ? (byte & 0x3Fu) | (codepoint << 6)
+                                  : (0xFFu >> byte_class) & byte;
+    return transitions[state * NUM_CLASSES + byte_class];
+  }
+
+  /// Are all bytes in this block plain ASCII?  Checks 16 bytes at a time with SSE2 when
+  /// available, otherwise 8 at a time in a 64-bit word.
+  static inline bool IsAscii(const char * data, size_t size) {
+    size_t pos = 0;
+#if defined(__SSE2__)
+    for (; pos + 16 <= size; pos += 16) {
+      const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+      if (_mm_movemask_epi8(block)) return false;
+    }
+#endif
+    for (; pos + 8 <= size; pos += 8) {
+      uint64_t block;
+      std::memcpy(&block, data + pos, 8);
+      if (block & 0x8080'8080'8080'8080ull) return false;
+    }
+    for (; pos < size; ++pos) {
+      if (static_cast<unsigned char>(data[pos]) & 0x80) return false;
+    }
+    return true;
+  }
+
+  /// Find the position of the first byte of an invalid (or truncated) UTF-8 sequence;
+  /// returns std::string_view::npos if the whole string is valid.
+  static inline size_t FindInvalid(std::string_view text) {
+    constexpr size_t BLOCK = 64;
+    size_t pos = 0;
+    while (pos < text.size()) {
+      // Skip quickly over runs of ASCII; most lines never leave this loop.
+      const size_t block_size = std::min(BLOCK, text.size() - pos);
+      if (IsAscii(text.data() + pos, block_size)) { pos += block_size; continue; }
+
+      // Decode this block byte by byte, finishing any sequence that crosses its end.
+      const size_t block_end = pos + block_size;
+      uint8_t state = ACCEPT;
+      uint32_t codepoint = 0;
+      size_t seq_start = pos;
+      while (pos < text.size() && (pos < block_end || state != ACCEPT)) {
+        if (state == ACCEPT) seq_start = pos;
+        state = Step(state, codepoint, static_cast<uint8_t>(text[pos++]));
+        if (state == REJECT) return seq_start;
+      }
+      if (state != ACCEPT) return seq_start;   // Truncated at end of text.
+    }
+    return std::string_view::npos;
+  }
+
+  static constexpr uint32_t REPLACEMENT = 0xFFFD;   ///< Stands in for invalid input (U+FFFD).
+
+  /// Call fun(codepoint) for each character in the text.  Each invalid or truncated sequence
+  /// becomes one REPLACEMENT, and decoding resumes at the byte that broke it (so a valid
+  /// character right after a bad byte is never lost).  Returns false if any were invalid.
+  template <typename FUN_T>
+  static bool Decode(std::string_view text, FUN_T && fun) {
+    bool valid = true;
+    size_t pos = 0;
+    while (pos < text.size()) {
+      uint8_t state = ACCEPT;
+      uint32_t codepoint = 0;
+      size_t end = pos;
+      do {
+        state = Step(state, codepoint, static_cast<uint8_t>(text[end++]));
+      } while (state != ACCEPT && state != REJECT && end < text.size());
+      if (state == ACCEPT) { fun(codepoint); pos = end; continue; }
+      fun(REPLACEMENT);
+      valid = false;
+      pos = (state == REJECT && end - 1 > pos) ? end - 1 : end;
+    }
+    return valid;
+  }
+
+  /// Convert a code point back into its UTF-8 bytes.
+  static inline std::string Encode(uint32_t codepoint) {
+    std::string out;
+    if (codepoint < 0x80) out += static_cast<char>(codepoint);
+    else if (codepoint < 0x800) {
+      out += static_cast<char>(0xC0 | (codepoint >> 6));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    else if (codepoint < 0x10000) {
+      out += static_cast<char>(0xE0 | (codepoint >> 12));
+      out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    else {
+      out += static_cast<char>(0xF0 | (codepoint >> 18));
+      out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+    return out;
+  }
+}
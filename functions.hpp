@@ -1,9 +1,72 @@
 #pragma once
 
-#include "emp/base/notify.hpp"
 #include "emp/base/vector.hpp"
 #include "emp/tools/String.hpp"
 
+#include "Diagnostics.hpp"
+#include "Entities.hpp"
+#include "Symbols.hpp"
+#include "Utf8.hpp"
+
+// Unknown entities (which Validate reports) are printed as written in every format, escaped
+// as needed, so that a typo is visible in the output rather than silently lost.
+
+// Plain text for a \&...; escape.
+static inline std::string EntityToRawText(std::string_view entity) {
+  const uint32_t codepoint = ParseEntity(entity);
+  if (codepoint == 0) return emp::MakeString('&', entity, ';').str();
+  if (const SymbolInfo * symbol = FindSymbol(codepoint)) return std::string(symbol->raw);
+  return (codepoint < 0x80) ? std::string(1, static_cast<char>(codepoint)) : "?";
+}
+
+// Latex for a \&...; escape.
+static inline std::string EntityToLatex(std::string_view entity) {
+  const uint32_t codepoint = ParseEntity(entity);
+  if (codepoint == 0) {
+    std::string out = "\\&";
+    for (char c : entity) {
+      if (c == '#' || c == '_' || c == '%' || c == '$' || c == '{' || c == '}') out += '\\';
+      out += c;
+    }
+    return out + ';';
+  }
+  if (const SymbolInfo * symbol = FindSymbol(codepoint)) return std::string(symbol->latex);
+  return utf8::Encode(codepoint);
+}
+
+// HTML (or D2L) for a \&...; escape: known entities are passed on for the browser to show.
+static inline std::string EntityToHTML(std::string_view entity, bool terminated=true) {
+  if (terminated && ParseEntity(entity) != 0) return emp::MakeString('&', entity, ';').str();
+  std::string out = "&amp;";
+  for (char c : entity) {
+    switch (c) {
+    case '&': out += "&amp;";  break;
+    case '<': out += "&lt;";   break;
+    case '>': out += "&gt;";   break;
+    case '"': out += "&quot;"; break;
+    case ',': out += "&#44;";  break;     // Keeps D2L csv fields intact.
+    default:  out += c;
+    }
+  }
+  return terminated ? out + ';' : out;
+}
+
+// Collect the contents of any \&...; escapes in the text that are not recognized.
+static inline emp::vector<emp::String> FindUnknownEntities(const emp::String & text) {
+  const std::string & str = text.str();
+  emp::vector<emp::String> unknown;
+  for (size_t pos = 0; pos + 1 < str.size(); ++pos) {
+    if (str[pos] != '\\') continue;
+    if (str[++pos] != '&') continue;               // Also skips the second char of '\\'.
+    const size_t end = str.find(';', pos);
+    if (end == std::string::npos) break;
+    const std::string_view entity(str.data() + pos + 1, end - pos - 1);
+    if (ParseEntity(entity) == 0) unknown.push_back(emp::String(std::string(entity)));
+    pos = end;
+  }
+  return unknown;
+}
+
 static inline emp::String LineToRawText(emp::String line) {
   emp::String out_line;
 
@@ -12,38 +75,23 @@ static inline emp::String LineToRawText(emp::String line) {
   bool start_scan = false;
   emp::String scan_word;
 
-  // If we have a negative value, we need to wait for another char to know the symbol
-  char partial = '\0';
-  for (char c : line) {
-    if (partial) {
-      int val1 = static_cast<int>(partial);
-      int val2 = static_cast<int>(c);
-      switch (val1) {
-      case -50:
-        switch (val2) {
-        case -87: out_line += "O"; break;
-        case -104: out_line += "T"; break;
-        default:
-          emp::notify::Error("Unknown char combo: ", val1, ",", val2, "\nline: ", line);          
-        }
-        break;
-      default:
-        emp::notify::Error("Unknown char combo: ", val1, ",", val2, "\nline: ", line);          
-      }
-      partial = '\0';
-      continue;
-    }
-    if (c < 0) {
-      partial = c;
-      continue;
-    }
+  // Runs of non-ASCII characters in plain text (never inside escapes) are decoded from UTF-8
+  // and replaced with an ASCII approximation.
+  std::string utf8_run;
+  auto flush_utf8 = [&](){
+    if (utf8_run.empty()) return;
+    const bool valid = utf8::Decode(utf8_run, [&out_line](uint32_t codepoint){
+      const SymbolInfo * symbol = FindSymbol(codepoint);
+      out_line += symbol ? std::string(symbol->raw) : std::string("?");
+    });
+    if (!valid) DiagnosticLog::Error("Invalid UTF-8 in line: ", line);
+    utf8_run.clear();
+  };
 
+  for (char c : line) {
     if (scan_to) {  // Do we need to literally translate?
       if (scan_to == c) {
-        if (c == ';') {
-          if (scan_word == "Theta") out_line += "T";
-          else if (scan_word == "Omega") out_line += "O";
-        }
+        if (c == ';') out_line += EntityToRawText(scan_word.str());
         scan_to = '\0';
         scan_word = "";
       } else {
@@ -66,6 +114,8 @@ static inline emp::String LineToRawText(emp::String line) {
       continue;
     }
 
+    if (static_cast<uint8_t>(c) >= 0x80) { utf8_run += c; continue; }
+    flush_utf8();
     switch (c) {
       case '\\': start_scan = true; break;
       case '`':  break;
@@ -74,21 +124,23 @@ static inline emp::String LineToRawText(emp::String line) {
         break;
     }
   }
+  flush_utf8();
 
   return out_line;
 }
 
 // Convert a single line of text to D2L format.
 static inline emp::String LineToD2L(emp::String line) {
-  emp::notify::TestError(line.Has('\n'), "Newline found inside of line: ", line);
+  DiagnosticLog::TestError(line.Has('\n'), "Newline found inside of line: ", line);
   emp::String out_line;
 
   bool in_codeblock = line.HasPrefix("    ");
   bool in_code = in_codeblock;
 
-  // Everything between backslash \& and ; or \< to > make literal
+  // Everything between backslash \& and ; or \< to > make literal (checking entity names)
   char scan_to = '\0';
   bool start_scan = false;
+  emp::String scan_word;
 
   if (in_codeblock) {
     line.PopFixed(4);
@@ -96,6 +148,15 @@ static inline emp::String LineToD2L(emp::String line) {
   }
 
   for (char c : line) {
+    if (scan_to == ';') {           // Entities are checked once their name is complete.
+      if (c == ';') {
+        out_line += EntityToHTML(scan_word.str());
+        scan_to = '\0';
+        scan_word = "";
+      }
+      else scan_word += c;
+      continue;
+    }
     if (scan_to) {
       out_line += c;
       if (scan_to == c) scan_to = '\0';
@@ -104,7 +165,7 @@ static inline emp::String LineToD2L(emp::String line) {
 
     if (start_scan) {
       switch (c) {
-      case '&': out_line += c; scan_to = ';'; break;
+      case '&': scan_to = ';'; break;
       case '<': out_line += c; scan_to = '>'; break;
       case '\\': out_line += c; break;
       case '\n': out_line += "<br>"; break;
@@ -142,6 +203,9 @@ static inline emp::String LineToD2L(emp::String line) {
     }
   }
 
+  // An entity left open at the end of the line is shown as written.
+  if (scan_to == ';') out_line += EntityToHTML(scan_word.str(), false);
+
   // If we are in code at the end of the entry, close it off.
   if (in_code) out_line += "</code>";
 
@@ -149,7 +213,7 @@ static inline emp::String LineToD2L(emp::String line) {
 }
 
 static inline emp::String LineToLatex(emp::String line) {
-  emp::notify::TestError(line.Has('\n'), "Newline found inside of line: ", line);
+  DiagnosticLog::TestError(line.Has('\n'), "Newline found inside of line: ", line);
   emp::String out_line;
 
   bool in_codeblock = line.HasPrefix("    ");
@@ -160,9 +224,6 @@ static inline emp::String LineToLatex(emp::String line) {
   bool start_scan = false;
   emp::String scan_word;
 
-  // If we have a negative value, we need to wait for another char to know the symbol
-  char partial = '\0';
-
   if (in_codeblock) {
     line.PopFixed(4);
     out_line += "\\texttt{";
@@ -173,36 +234,25 @@ static inline emp::String LineToLatex(emp::String line) {
     line.PopFixed(ws_count);
   }
 
-  for (char c : line) {
-    if (partial) {
-      int val1 = static_cast<int>(partial);
-      int val2 = static_cast<int>(c);
-      switch (val1) {
-      case -50:
-        switch (val2) {
-        case -87: out_line += "$\\Omega$"; break;
-        case -104: out_line += "$\\Theta$"; break;
-        default:
-          emp::notify::Error("Unknown char combo: ", val1, ",", val2, "\nline: ", line);          
-        }
-        break;
-      default:
-        emp::notify::Error("Unknown char combo: ", val1, ",", val2, "\nline: ", line);          
-      }
-      partial = '\0';
-      continue;
-    }
-    if (c < 0) {
-      partial = c;
-      continue;
-    }
+  // Runs of non-ASCII characters in plain text (never inside escapes) are decoded from UTF-8
+  // and converted to Latex.
+  std::string utf8_run;
+  auto flush_utf8 = [&](){
+    if (utf8_run.empty()) return;
+    const bool valid = utf8::Decode(utf8_run, [&out_line](uint32_t codepoint){
+      const SymbolInfo * symbol = FindSymbol(codepoint);
+      // Unknown symbols are passed through for Latex's own UTF-8 support to handle.
+      if (symbol) out_line += std::string(symbol->latex);
+      else out_line += utf8::Encode(codepoint);
+    });
+    if (!valid) DiagnosticLog::Error("Invalid UTF-8 in line: ", line);
+    utf8_run.clear();
+  };
 
+  for (char c : line) {
     if (scan_to) {  // Do we need to literally translate?
       if (scan_to == c) {
-        if (c == ';') {
-          if (scan_word == "Theta") out_line += "$\\Theta$";
-          else if (scan_word == "Omega") out_line += "$\\Omega$";
-        }
+        if (c == ';') out_line += EntityToLatex(scan_word.str());
         else if (c == '>') {
           if (scan_word == "b") out_line += "\\textbf{";
           else if (scan_word == "/b") out_line += "}";
@@ -235,6 +285,8 @@ static inline emp::String LineToLatex(emp::String line) {
       continue;
     }
 
+    if (static_cast<uint8_t>(c) >= 0x80) { utf8_run += c; continue; }
+    flush_utf8();
     switch (c) {
       case '{': out_line += "\\{";  break;
       case '}': out_line += "\\}";  break;
@@ -266,6 +318,8 @@ static inline emp::String LineToLatex(emp::String line) {
     }
   }
 
+  flush_utf8();
+
   // If we are in code at the end of the entry, close it off.
   if (in_code) out_line += "}";
 
@@ -273,15 +327,16 @@ static inline emp::String LineToLatex(emp::String line) {
 }
 
 static inline emp::String LineToHTML(emp::String line) {
-  emp::notify::TestError(line.Has('\n'), "Newline found inside of line: ", line);
+  DiagnosticLog::TestError(line.Has('\n'), "Newline found inside of line: ", line);
   emp::String out_line;
 
   bool in_codeblock = line.HasPrefix("    ");
   bool in_code = in_codeblock;
 
-  // Everything between backslash \& and ; or \< to > make literal
+  // Everything between backslash \& and ; or \< to > make literal (checking entity names)
   char scan_to = '\0';
   bool start_scan = false;
+  emp::String scan_word;
 
   if (in_codeblock) {
     line.PopFixed(4);
@@ -296,6 +351,15 @@ static inline emp::String LineToHTML(emp::String line) {
   }
 
   for (char c : line) {
+    if (scan_to == ';') {           // Entities are checked once their name is complete.
+      if (c == ';') {
+        out_line += EntityToHTML(scan_word.str());
+        scan_to = '\0';
+        scan_word = "";
+      }
+      else scan_word += c;
+      continue;
+    }
     if (scan_to) {  // Do we need to literally translate?
       out_line += c;
       if (scan_to == c) scan_to = '\0';
@@ -304,7 +368,7 @@ static inline emp::String LineToHTML(emp::String line) {
 
     if (start_scan) {
       switch (c) {
-      case '&': out_line += c; scan_to = ';'; break;
+      case '&': scan_to = ';'; break;
       case '<': out_line += c; scan_to = '>'; break;
       case '\\': out_line += c; break;
       case 'n': out_line += "<br>"; break;
@@ -341,6 +405,9 @@ static inline emp::String LineToHTML(emp::String line) {
     }
   }
 
+  // An entity left open at the end of the line is shown as written.
+  if (scan_to == ';') out_line += EntityToHTML(scan_word.str(), false);
+
   // If we are in code at the end of the entry, close it off.
   if (in_code) out_line += "</code>";
 